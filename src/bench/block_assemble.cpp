@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <consensus/consensus.h>
+#include <consensus/validation.h>
 #include <node/miner.h>
 #include <primitives/transaction.h>
 #include <random.h>
@@ -12,7 +13,9 @@
 #include <test/util/mining.h>
 #include <test/util/script.h>
 #include <test/util/setup_common.h>
+#include <txmempool.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <array>
 #include <cassert>
@@ -21,6 +24,7 @@
 #include <vector>
 
 using node::BlockAssembler;
+using node::BlockTemplateCache;
 
 static void AssembleBlock(benchmark::Bench& bench)
 {
@@ -69,5 +73,76 @@ static void BlockAssemblerAddPackageTxns(benchmark::Bench& bench)
     });
 }
 
+// Get a block template over and over while a transaction that is not good
+// enough to make it into the (full) block enters and leaves the mempool,
+// either building it from scratch every time or through BlockTemplateCache.
+static void BlockTemplateChurn(benchmark::Bench& bench, bool use_cache)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    auto& chainman{*test_setup->m_node.chainman};
+    auto& mempool{*test_setup->m_node.mempool};
+    auto& validation_signals{*test_setup->m_node.validation_signals};
+
+    CScriptWitness witness;
+    witness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+    BlockAssembler::Options options;
+    options.coinbase_output_script = P2WSH_OP_TRUE;
+    options.test_block_validity = false;
+
+    // Spend the mature coinbases at increasing feerates, keeping one for the
+    // transaction that comes and goes.
+    constexpr size_t NUM_BLOCKS{200};
+    std::vector<CTransactionRef> txs;
+    for (size_t b{0}; b < NUM_BLOCKS; ++b) {
+        const COutPoint coinbase{MineBlock(test_setup->m_node, options)};
+        if (NUM_BLOCKS - b < COINBASE_MATURITY) continue;
+        const CAmount value{WITH_LOCK(::cs_main, return chainman.ActiveChainstate().CoinsTip().AccessCoin(coinbase).out.nValue)};
+        CMutableTransaction tx;
+        tx.vin.emplace_back(coinbase);
+        tx.vin.back().scriptWitness = witness;
+        tx.vout.emplace_back(value - 1000 * static_cast<CAmount>(txs.size() + 1), P2WSH_OP_TRUE);
+        txs.push_back(MakeTransactionRef(tx));
+    }
+    const CTransactionRef churn_tx{txs.front()};
+    {
+        LOCK(::cs_main);
+        for (size_t i{1}; i < txs.size(); ++i) {
+            const MempoolAcceptResult res = chainman.ProcessTransaction(txs[i]);
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+    }
+
+    // Leave room for half of them.
+    options.nBlockMaxWeight = options.coinbase_max_additional_weight + GetTransactionWeight(*churn_tx) * txs.size() / 2;
+
+    BlockTemplateCache cache;
+    validation_signals.RegisterValidationInterface(&cache);
+    validation_signals.SyncWithValidationInterfaceQueue();
+    const auto get_template{[&] {
+        if (use_cache) return cache.Get(chainman.ActiveChainstate(), mempool, options);
+        return BlockAssembler{chainman.ActiveChainstate(), &mempool, options}.CreateNewBlock();
+    }};
+    const size_t num_block_txs{get_template()->block.vtx.size()};
+
+    bench.run([&] {
+        {
+            LOCK(::cs_main);
+            const MempoolAcceptResult res = chainman.ProcessTransaction(churn_tx);
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+        validation_signals.SyncWithValidationInterfaceQueue();
+        assert(get_template()->block.vtx.size() == num_block_txs);
+        WITH_LOCK(mempool.cs, mempool.removeRecursive(*churn_tx, MemPoolRemovalReason::EXPIRY));
+        validation_signals.SyncWithValidationInterfaceQueue();
+    });
+
+    validation_signals.UnregisterValidationInterface(&cache);
+}
+
+static void BlockTemplateChurnRebuild(benchmark::Bench& bench) { BlockTemplateChurn(bench, /*use_cache=*/false); }
+static void BlockTemplateChurnCached(benchmark::Bench& bench) { BlockTemplateChurn(bench, /*use_cache=*/true); }
+
 BENCHMARK(AssembleBlock, benchmark::PriorityLevel::HIGH);
 BENCHMARK(BlockAssemblerAddPackageTxns, benchmark::PriorityLevel::LOW);
+BENCHMARK(BlockTemplateChurnRebuild, benchmark::PriorityLevel::HIGH);
+BENCHMARK(BlockTemplateChurnCached, benchmark::PriorityLevel::HIGH);
@@ -8,11 +8,15 @@
 #include <key.h>
 #include <policy/policy.h>
 #include <primitives/transaction.h>
+#include <random.h>
 #include <script/script.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
+#include <uint256.h>
+#include <util/string.h>
 
 #include <cassert>
+#include <cstdint>
 #include <vector>
 
 // Microbenchmark for simple accesses to a CCoinsViewCache database. Note from
@@ -54,4 +58,43 @@ static void CCoinsCaching(benchmark::Bench& bench)
     });
 }
 
+// Fill an empty cache with coins of a single output type and measure the time
+// per added coin. How many such coins fit in 1 GiB of cache, according to the
+// cache's own memory accounting, is attached to the result as the
+// "coins_per_gib" context, which a custom nanobench template can render with
+// {{context(coins_per_gib)}}.
+static void CCoinsCachingFill(benchmark::Bench& bench, const CScript& script_pubkey)
+{
+    constexpr uint32_t NUM_COINS{1 << 16};
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    for (uint32_t i{0}; i < NUM_COINS; ++i) {
+        outpoints.emplace_back(Txid::FromUint256(rng.rand256()), i % 4);
+    }
+
+    CCoinsView coins_dummy;
+    const auto fill{[&] {
+        CCoinsViewCache coins{&coins_dummy};
+        for (const COutPoint& outpoint : outpoints) {
+            coins.AddCoin(outpoint, Coin{CTxOut{COIN, script_pubkey}, /*nHeightIn=*/800'000, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+        }
+        return coins.DynamicMemoryUsage();
+    }};
+    bench.context("coins_per_gib", util::ToString((uint64_t{1} << 30) * NUM_COINS / fill()));
+    bench.batch(NUM_COINS).unit("coin").run(fill);
+}
+
+static void CCoinsCachingFillP2WPKH(benchmark::Bench& bench)
+{
+    CCoinsCachingFill(bench, CScript{} << OP_0 << std::vector<unsigned char>(20, 0x42));
+}
+
+static void CCoinsCachingFillP2TR(benchmark::Bench& bench)
+{
+    CCoinsCachingFill(bench, CScript{} << OP_1 << std::vector<unsigned char>(32, 0x42));
+}
+
 BENCHMARK(CCoinsCaching, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCachingFillP2WPKH, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCachingFillP2TR, benchmark::PriorityLevel::HIGH);
@@ -22,7 +22,7 @@ static const unsigned int QUEUE_BATCH_SIZE = 128;
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
 // and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+static void CCheckQueueSpeed(benchmark::Bench& bench, int worker_threads_num)
 {
     // We shouldn't ever be running with the checkqueue on a single core machine.
     if (GetNumCores() <= 1) return;
@@ -40,9 +40,6 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
         }
     };
 
-    // The main thread should be counted to prevent thread oversubscription, and
-    // to decrease the variance of benchmark results.
-    int worker_threads_num{GetNumCores() - 1};
     CCheckQueue<PrevectorJob> queue{QUEUE_BATCH_SIZE, worker_threads_num};
 
     // create all the data once, then submit copies in the benchmark.
@@ -65,4 +62,22 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
         control.Complete();
     });
 }
+
+// The main thread should be counted to prevent thread oversubscription, and
+// to decrease the variance of benchmark results.
+static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench) { CCheckQueueSpeed(bench, GetNumCores() - 1); }
+
+// Fixed total thread counts (including the main thread), to see how the
+// queue scales with -par. Counts above the number of cores oversubscribe.
+static void CCheckQueueSpeedPrevectorJob2Threads(benchmark::Bench& bench)  { CCheckQueueSpeed(bench, 1);  }
+static void CCheckQueueSpeedPrevectorJob4Threads(benchmark::Bench& bench)  { CCheckQueueSpeed(bench, 3);  }
+static void CCheckQueueSpeedPrevectorJob8Threads(benchmark::Bench& bench)  { CCheckQueueSpeed(bench, 7);  }
+static void CCheckQueueSpeedPrevectorJob16Threads(benchmark::Bench& bench) { CCheckQueueSpeed(bench, 15); }
+static void CCheckQueueSpeedPrevectorJob32Threads(benchmark::Bench& bench) { CCheckQueueSpeed(bench, 31); }
+
 BENCHMARK(CCheckQueueSpeedPrevectorJob, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueSpeedPrevectorJob2Threads, benchmark::PriorityLevel::LOW);
+BENCHMARK(CCheckQueueSpeedPrevectorJob4Threads, benchmark::PriorityLevel::LOW);
+BENCHMARK(CCheckQueueSpeedPrevectorJob8Threads, benchmark::PriorityLevel::LOW);
+BENCHMARK(CCheckQueueSpeedPrevectorJob16Threads, benchmark::PriorityLevel::LOW);
+BENCHMARK(CCheckQueueSpeedPrevectorJob32Threads, benchmark::PriorityLevel::LOW);
@@ -0,0 +1,77 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data/block413567.raw.h>
+#include <checkqueue.h>
+#include <coins.h>
+#include <common/system.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <streams.h>
+#include <txdb.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// Fill an in-memory coins database with a coin for every input of a real
+// block, and measure how long it takes to bring all of them into an empty
+// (cold) cache, either on first access or with a parallel prefetch.
+namespace {
+struct CoinsPrefetchSetup {
+    CCoinsViewDB db{{.path = "coins_prefetch", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    std::vector<COutPoint> prevouts;
+
+    CoinsPrefetchSetup()
+    {
+        DataStream stream{benchmark::data::block413567};
+        CBlock block;
+        stream >> TX_WITH_WITNESS(block);
+
+        CCoinsViewCache cache{&db};
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                prevouts.push_back(txin.prevout);
+                CScript script_pubkey{CScript{} << OP_0 << std::vector<unsigned char>(20, 0x42)};
+                cache.AddCoin(txin.prevout, Coin{CTxOut{1000, script_pubkey}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/true);
+            }
+        }
+        cache.SetBestBlock(uint256::ONE);
+        assert(cache.Flush());
+    }
+};
+} // namespace
+
+static void CoinsFetchOnAccess(benchmark::Bench& bench)
+{
+    CoinsPrefetchSetup setup;
+    bench.batch(setup.prevouts.size()).unit("coin").run([&] {
+        CCoinsViewCache cache{&setup.db};
+        for (const COutPoint& prevout : setup.prevouts) {
+            assert(!cache.AccessCoin(prevout).IsSpent());
+        }
+    });
+}
+
+static void CoinsPrefetchParallel(benchmark::Bench& bench)
+{
+    CoinsPrefetchSetup setup;
+    // The main thread takes part in the lookups as well.
+    CoinsFetchQueue queue{/*batch_size=*/16, std::max(GetNumCores() - 1, 1)};
+    bench.batch(setup.prevouts.size()).unit("coin").run([&] {
+        CCoinsViewCache cache{&setup.db};
+        cache.PrefetchCoins(setup.prevouts, queue);
+        for (const COutPoint& prevout : setup.prevouts) {
+            assert(cache.HaveCoinInCache(prevout));
+        }
+    });
+}
+
+BENCHMARK(CoinsFetchOnAccess, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CoinsPrefetchParallel, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,78 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <kernel/coinstats.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Fill an in-memory coins database with a synthetic UTXO set of a few million
+// coins, and measure how long it takes to compute its statistics and hash,
+// either on a single thread (through a view that does not provide snapshot
+// cursors) or on several threads reading ranges of the database at once.
+namespace {
+constexpr uint32_t NUM_TXS{500'000};
+constexpr uint32_t OUTPUTS_PER_TX{4};
+
+struct CoinStatsSetup {
+    const std::unique_ptr<const TestingSetup> testing_setup{MakeNoLogFileContext<const TestingSetup>()};
+    CCoinsViewDB db{{.path = "coinstats", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+
+    CoinStatsSetup()
+    {
+        FastRandomContext rng{/*fDeterministic=*/true};
+        CCoinsViewCache cache{&db};
+        const CScript script_pubkey{CScript{} << OP_0 << std::vector<unsigned char>(20, 0x42)};
+        for (uint32_t i = 0; i < NUM_TXS; ++i) {
+            const Txid txid{Txid::FromUint256(rng.rand256())};
+            for (uint32_t n = 0; n < OUTPUTS_PER_TX; ++n) {
+                cache.AddCoin(COutPoint{txid, n}, Coin{CTxOut{1000 + n, script_pubkey}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+            }
+            // Keep the cache small while building the set.
+            if (i % 50'000 == 0) {
+                cache.SetBestBlock(uint256::ONE);
+                assert(cache.Flush());
+            }
+        }
+        // The statistics are reported at the block the view is at, which has
+        // to be in the block index.
+        cache.SetBestBlock(WITH_LOCK(::cs_main, return testing_setup->m_node.chainman->ActiveChain().Genesis()->GetBlockHash()));
+        assert(cache.Flush());
+    }
+
+    node::BlockManager& BlockMan() const { return testing_setup->m_node.chainman->m_blockman; }
+};
+
+void ComputeStats(benchmark::Bench& bench, kernel::CoinStatsHashType hash_type, bool parallel)
+{
+    CoinStatsSetup setup;
+    CCoinsViewBacked serial_view{&setup.db};
+    CCoinsView* view{parallel ? static_cast<CCoinsView*>(&setup.db) : &serial_view};
+    bench.batch(NUM_TXS * OUTPUTS_PER_TX).unit("coin").run([&] {
+        const auto stats{kernel::ComputeUTXOStats(hash_type, view, setup.BlockMan())};
+        assert(stats && stats->coins_count == NUM_TXS * OUTPUTS_PER_TX);
+    });
+}
+} // namespace
+
+static void CoinStatsSerializedSerial(benchmark::Bench& bench) { ComputeStats(bench, kernel::CoinStatsHashType::HASH_SERIALIZED, /*parallel=*/false); }
+static void CoinStatsSerializedParallel(benchmark::Bench& bench) { ComputeStats(bench, kernel::CoinStatsHashType::HASH_SERIALIZED, /*parallel=*/true); }
+static void CoinStatsMuHashSerial(benchmark::Bench& bench) { ComputeStats(bench, kernel::CoinStatsHashType::MUHASH, /*parallel=*/false); }
+static void CoinStatsMuHashParallel(benchmark::Bench& bench) { ComputeStats(bench, kernel::CoinStatsHashType::MUHASH, /*parallel=*/true); }
+
+BENCHMARK(CoinStatsSerializedSerial, benchmark::PriorityLevel::LOW);
+BENCHMARK(CoinStatsSerializedParallel, benchmark::PriorityLevel::LOW);
+BENCHMARK(CoinStatsMuHashSerial, benchmark::PriorityLevel::LOW);
+BENCHMARK(CoinStatsMuHashParallel, benchmark::PriorityLevel::LOW);
@@ -181,6 +181,54 @@ static void SHA256D64_1024_SHANI(benchmark::Bench& bench)
     SHA256AutoDetect();
 }
 
+static void SHA256D80_2000_STANDARD(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' SHA256 implementation", __func__, SHA256AutoDetect(sha256_implementation::STANDARD)));
+    // As many 80-byte block headers as fit in a headers message.
+    std::vector<uint8_t> in(80 * 2000, 0);
+    std::vector<uint8_t> out(32 * 2000);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256D80(out.data(), in.data(), 2000);
+    });
+    SHA256AutoDetect();
+}
+
+static void SHA256D80_2000_SSE4(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' SHA256 implementation", __func__, SHA256AutoDetect(sha256_implementation::USE_SSE4)));
+    // As many 80-byte block headers as fit in a headers message.
+    std::vector<uint8_t> in(80 * 2000, 0);
+    std::vector<uint8_t> out(32 * 2000);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256D80(out.data(), in.data(), 2000);
+    });
+    SHA256AutoDetect();
+}
+
+static void SHA256D80_2000_AVX2(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' SHA256 implementation", __func__, SHA256AutoDetect(sha256_implementation::USE_SSE4_AND_AVX2)));
+    // As many 80-byte block headers as fit in a headers message.
+    std::vector<uint8_t> in(80 * 2000, 0);
+    std::vector<uint8_t> out(32 * 2000);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256D80(out.data(), in.data(), 2000);
+    });
+    SHA256AutoDetect();
+}
+
+static void SHA256D80_2000_SHANI(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' SHA256 implementation", __func__, SHA256AutoDetect(sha256_implementation::USE_SSE4_AND_SHANI)));
+    // As many 80-byte block headers as fit in a headers message.
+    std::vector<uint8_t> in(80 * 2000, 0);
+    std::vector<uint8_t> out(32 * 2000);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256D80(out.data(), in.data(), 2000);
+    });
+    SHA256AutoDetect();
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -267,6 +315,10 @@ BENCHMARK(SHA256D64_1024_STANDARD, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024_SSE4, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024_AVX2, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024_SHANI, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SHA256D80_2000_STANDARD, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SHA256D80_2000_SSE4, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SHA256D80_2000_AVX2, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SHA256D80_2000_SHANI, benchmark::PriorityLevel::HIGH);
 
 BENCHMARK(MuHash, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MuHashMul, benchmark::PriorityLevel::HIGH);
@@ -5,22 +5,51 @@
 #include <bench/bench.h>
 #include <bench/data/block413567.raw.h>
 #include <chainparams.h>
+#include <common/system.h>
 #include <flatfile.h>
 #include <node/blockstorage.h>
 #include <span.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
+#include <tinyformat.h>
 #include <uint256.h>
 #include <util/fs.h>
+#include <util/signalinterrupt.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cstdint>
 #include <cstdio>
 #include <map>
 #include <memory>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
+/** Create a test block file filled with copies of the same block, see below. */
+static void CreateBlockFile(const fs::path& path, const CChainParams& params, size_t file_size)
+{
+    // Create a single block as in the blocks files (magic bytes, block size,
+    // block data) as a stream object.
+    DataStream ss{};
+    ss << params.MessageStart();
+    ss << static_cast<uint32_t>(benchmark::data::block413567.size());
+    // We can't use the streaming serialization (ss << benchmark::data::block413567)
+    // because that first writes a compact size.
+    ss << Span{benchmark::data::block413567};
+
+    // "wb+" is "binary, O_RDWR | O_CREAT | O_TRUNC".
+    FILE* file{fsbridge::fopen(path, "wb+")};
+    for (size_t i = 0; i < file_size / ss.size(); ++i) {
+        if (fwrite(ss.data(), 1, ss.size(), file) != ss.size()) {
+            throw std::runtime_error("write to test file failed\n");
+        }
+    }
+    fclose(file);
+}
+
 /**
  * The LoadExternalBlockFile() function is used during -reindex and -loadblock.
  *
@@ -37,29 +66,9 @@ static void LoadExternalBlockFile(benchmark::Bench& bench)
 {
     const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
 
-    // Create a single block as in the blocks files (magic bytes, block size,
-    // block data) as a stream object.
     const fs::path blkfile{testing_setup.get()->m_path_root / "blk.dat"};
-    DataStream ss{};
-    auto params{testing_setup->m_node.chainman->GetParams()};
-    ss << params.MessageStart();
-    ss << static_cast<uint32_t>(benchmark::data::block413567.size());
-    // We can't use the streaming serialization (ss << benchmark::data::block413567)
-    // because that first writes a compact size.
-    ss << Span{benchmark::data::block413567};
-
-    // Create the test file.
-    {
-        // "wb+" is "binary, O_RDWR | O_CREAT | O_TRUNC".
-        FILE* file{fsbridge::fopen(blkfile, "wb+")};
-        // Make the test block file about 128 MB in length.
-        for (size_t i = 0; i < node::MAX_BLOCKFILE_SIZE / ss.size(); ++i) {
-            if (fwrite(ss.data(), 1, ss.size(), file) != ss.size()) {
-                throw std::runtime_error("write to test file failed\n");
-            }
-        }
-        fclose(file);
-    }
+    // Make the test block file about 128 MB in length.
+    CreateBlockFile(blkfile, testing_setup->m_node.chainman->GetParams(), node::MAX_BLOCKFILE_SIZE);
 
     std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
     FlatFilePos pos;
@@ -72,4 +81,60 @@ static void LoadExternalBlockFile(benchmark::Bench& bench)
     fs::remove(blkfile);
 }
 
+/**
+ * A parallel -reindex has worker threads locate, deserialize and check every
+ * block of the upcoming block files with ReadExternalBlockFile(), while the
+ * blocks are accepted in order on another thread.
+ *
+ * This benchmark measures that reading part, for the same amount of block data
+ * as above spread over several smaller files, once on a single thread and once
+ * on as many threads as a parallel -reindex would use.
+ */
+static void ReadExternalBlockFiles(benchmark::Bench& bench, int num_threads)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN)};
+    const CChainParams& params{testing_setup->m_node.chainman->GetParams()};
+
+    constexpr int NUM_FILES{8};
+    std::vector<fs::path> blkfiles;
+    for (int i = 0; i < NUM_FILES; ++i) {
+        blkfiles.push_back(testing_setup.get()->m_path_root / fs::u8path(strprintf("blk%05u.dat", i)));
+        CreateBlockFile(blkfiles.back(), params, node::MAX_BLOCKFILE_SIZE / NUM_FILES);
+    }
+
+    bench.run([&] {
+        std::atomic<int> next_file{0};
+        const auto read_files{[&] {
+            for (int i{next_file++}; i < NUM_FILES; i = next_file++) {
+                AutoFile file{fsbridge::fopen(blkfiles[i], "rb")};
+                const std::vector<ExternalBlock> blocks{ReadExternalBlockFile(file, i, params, *testing_setup->m_node.shutdown_signal)};
+                assert(!blocks.empty());
+            }
+        }};
+        std::vector<std::thread> workers;
+        for (int n = 1; n < num_threads; ++n) {
+            workers.emplace_back(read_files);
+        }
+        read_files();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    });
+    for (const fs::path& blkfile : blkfiles) {
+        fs::remove(blkfile);
+    }
+}
+
+static void ReadExternalBlockFilesSingle(benchmark::Bench& bench)
+{
+    ReadExternalBlockFiles(bench, /*num_threads=*/1);
+}
+
+static void ReadExternalBlockFilesParallel(benchmark::Bench& bench)
+{
+    ReadExternalBlockFiles(bench, std::clamp(GetNumCores(), 1, node::MAX_REINDEX_THREADS));
+}
+
 BENCHMARK(LoadExternalBlockFile, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadExternalBlockFilesSingle, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadExternalBlockFilesParallel, benchmark::PriorityLevel::HIGH);
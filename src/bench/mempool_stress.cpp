@@ -111,6 +111,38 @@ static void ComplexMemPool(benchmark::Bench& bench)
     });
 }
 
+static void MempoolAddRemove(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    std::vector<CTransactionRef> ordered_coins = CreateOrderedCoins(det_rand, /*childTxs=*/2000, /*min_ancestors=*/1);
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    bench.batch(ordered_coins.size()).unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (auto& tx : ordered_coins) {
+            AddTx(tx, pool);
+        }
+        pool.removeForBlock(ordered_coins, /*nBlockHeight=*/1);
+    });
+}
+
+// Block assembly sorts the mempool by ancestor score each time a template is
+// built, as there is no index kept for it.
+static void MempoolSortByAncestorScore(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    std::vector<CTransactionRef> ordered_coins = CreateOrderedCoins(det_rand, /*childTxs=*/20000, /*min_ancestors=*/1);
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    for (auto& tx : ordered_coins) {
+        AddTx(tx, pool);
+    }
+    bench.batch(pool.size()).unit("tx").run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        ankerl::nanobench::doNotOptimizeAway(pool.GetSortedByAncestorScore());
+    });
+}
+
 static void MempoolCheck(benchmark::Bench& bench)
 {
     FastRandomContext det_rand{true};
@@ -127,4 +159,6 @@ static void MempoolCheck(benchmark::Bench& bench)
 }
 
 BENCHMARK(ComplexMemPool, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolAddRemove, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolSortByAncestorScore, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MempoolCheck, benchmark::PriorityLevel::HIGH);
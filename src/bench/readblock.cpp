@@ -4,14 +4,18 @@
 
 #include <bench/bench.h>
 #include <bench/data/block413567.raw.h>
+#include <chainparams.h>
 #include <flatfile.h>
 #include <node/blockstorage.h>
+#include <node/context.h>
+#include <node/kernel_notifications.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
+#include <util/check.h>
 #include <validation.h>
 
 #include <cassert>
@@ -56,5 +60,43 @@ static void ReadRawBlockFromDiskTest(benchmark::Bench& bench)
     });
 }
 
+// Same as above, but with memory-mapped reads. The block is written twice with
+// fast pruning (small block files) so that the second copy starts a new file,
+// and the first one is read from a finalized, mapped file.
+static void ReadBlockFromMappedFile(benchmark::Bench& bench, bool raw, bool use_xor)
+{
+    const auto testing_setup{MakeNoLogFileContext<BasicTestingSetup>(ChainType::MAIN)};
+    node::NodeContext& node{testing_setup->m_node};
+    node::KernelNotifications notifications{Assert(node.shutdown_request), node.exit_status, *Assert(node.warnings)};
+    const node::BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .use_xor = use_xor,
+        .use_mmap = true,
+        .fast_prune = true,
+        .blocks_dir = testing_setup->m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+    };
+    node::BlockManager blockman{*Assert(node.shutdown_signal), blockman_opts};
+
+    DataStream stream{benchmark::data::block413567};
+    CBlock block;
+    stream >> TX_WITH_WITNESS(block);
+    const auto pos{blockman.SaveBlockToDisk(block, 0)};
+    assert(blockman.SaveBlockToDisk(block, 1).nFile != pos.nFile);
+
+    std::vector<uint8_t> block_data;
+    bench.run([&] {
+        const auto success{raw ? blockman.ReadRawBlockFromDisk(block_data, pos) : blockman.ReadBlockFromDisk(block, pos)};
+        assert(success);
+    });
+}
+
+static void ReadBlockFromMappedFileTest(benchmark::Bench& bench) { ReadBlockFromMappedFile(bench, /*raw=*/false, /*use_xor=*/true); }
+static void ReadBlockFromMappedFileNoXorTest(benchmark::Bench& bench) { ReadBlockFromMappedFile(bench, /*raw=*/false, /*use_xor=*/false); }
+static void ReadRawBlockFromMappedFileTest(benchmark::Bench& bench) { ReadBlockFromMappedFile(bench, /*raw=*/true, /*use_xor=*/true); }
+
 BENCHMARK(ReadBlockFromDiskTest, benchmark::PriorityLevel::HIGH);
 BENCHMARK(ReadRawBlockFromDiskTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadBlockFromMappedFileTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadBlockFromMappedFileNoXorTest, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ReadRawBlockFromMappedFileTest, benchmark::PriorityLevel::HIGH);
@@ -10,19 +10,19 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <vector>
 
-static void FindByte(benchmark::Bench& bench)
+static void FindByteInFile(benchmark::Bench& bench, size_t file_size)
 {
     // Setup
     AutoFile file{fsbridge::fopen("streams_tmp", "w+b")};
-    const size_t file_size = 200;
-    uint8_t data[file_size] = {0};
+    std::vector<uint8_t> data(file_size);
     data[file_size-1] = 1;
-    file << data;
+    file << Span{data};
     file.seek(0, SEEK_SET);
     BufferedFile bf{file, /*nBufSize=*/file_size + 1, /*nRewindIn=*/file_size};
 
-    bench.run([&] {
+    bench.batch(file_size).unit("byte").run([&] {
         bf.SetPos(0);
         bf.FindByte(std::byte(1));
     });
@@ -32,4 +32,17 @@ static void FindByte(benchmark::Bench& bench)
     fs::remove("streams_tmp");
 }
 
+static void FindByte(benchmark::Bench& bench)
+{
+    FindByteInFile(bench, /*file_size=*/200);
+}
+
+// Scan past a long run of zeros, like the preallocated space at the end of a
+// block file, for the next magic byte.
+static void FindByteLarge(benchmark::Bench& bench)
+{
+    FindByteInFile(bench, /*file_size=*/1 << 20);
+}
+
 BENCHMARK(FindByte, benchmark::PriorityLevel::HIGH);
+BENCHMARK(FindByteLarge, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,92 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addresstype.h>
+#include <bench/bench.h>
+#include <coins.h>
+#include <key.h>
+#include <primitives/transaction.h>
+#include <pubkey.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/sigcache.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <span.h>
+#include <test/util/random.h>
+#include <uint256.h>
+#include <util/translation.h>
+#include <validation.h>
+
+#include <cassert>
+#include <map>
+#include <vector>
+
+// Verify the inputs of a transaction that only has taproot key path spends.
+// This is the baseline for deferring the signatures of a script check batch
+// to SchnorrBatch, once it offers real batch verification.
+namespace {
+constexpr size_t NUM_INPUTS{1024};
+constexpr unsigned int FLAGS{SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT};
+
+struct TaprootSpendSetup {
+    ECC_Context ecc_context{};
+    std::vector<CTxOut> spent_outputs;
+    CTransaction tx;
+    PrecomputedTransactionData txdata;
+    // Keep it small: nothing is stored in it, and it has to be empty for the
+    // signatures to be verified in every iteration.
+    SignatureCache signature_cache{1 << 20};
+
+    TaprootSpendSetup() : tx{CreateTransaction(spent_outputs)}
+    {
+        txdata.Init(tx, std::vector<CTxOut>{spent_outputs});
+    }
+
+    static CMutableTransaction CreateTransaction(std::vector<CTxOut>& spent_outputs)
+    {
+        FlatSigningProvider keystore;
+        std::map<COutPoint, Coin> coins;
+        CMutableTransaction mtx;
+        for (size_t i = 0; i < NUM_INPUTS; ++i) {
+            CKey privkey = GenerateRandomKey();
+            CPubKey pubkey = privkey.GetPubKey();
+            keystore.keys.emplace(pubkey.GetID(), privkey);
+            keystore.pubkeys.emplace(pubkey.GetID(), pubkey);
+            const COutPoint prevout{Txid::FromUint256(uint256::ONE), static_cast<uint32_t>(i)};
+            const CTxOut txout{10000, GetScriptForDestination(WitnessV1Taproot(XOnlyPubKey{pubkey}))};
+            coins[prevout] = Coin(txout, /*nHeightIn=*/100, /*fCoinBaseIn=*/false);
+            spent_outputs.push_back(txout);
+            mtx.vin.emplace_back(prevout);
+        }
+        mtx.vout.emplace_back(1000, CScript{} << OP_TRUE);
+        std::map<int, bilingual_str> input_errors;
+        const bool complete{SignTransaction(mtx, &keystore, coins, SIGHASH_DEFAULT, input_errors)};
+        assert(complete);
+        return mtx;
+    }
+
+    std::vector<CScriptCheck> MakeChecks()
+    {
+        std::vector<CScriptCheck> checks;
+        checks.reserve(NUM_INPUTS);
+        for (unsigned int i = 0; i < NUM_INPUTS; ++i) {
+            checks.emplace_back(spent_outputs[i], tx, signature_cache, i, FLAGS, /*cacheIn=*/false, &txdata);
+        }
+        return checks;
+    }
+};
+} // namespace
+
+static void VerifyTaprootSingle(benchmark::Bench& bench)
+{
+    TaprootSpendSetup setup;
+    bench.batch(NUM_INPUTS).unit("sig").run([&] {
+        for (CScriptCheck& check : setup.MakeChecks()) {
+            assert(!check().has_value());
+        }
+    });
+}
+
+BENCHMARK(VerifyTaprootSingle, benchmark::PriorityLevel::HIGH);
@@ -21,4 +21,18 @@ static void Xor(benchmark::Bench& bench)
     });
 }
 
+// Deobfuscate a block-sized buffer with an 8-byte key, as for every block read
+// from an obfuscated blocks directory, starting at an offset into the key.
+static void XorObfuscationKey(benchmark::Bench& bench)
+{
+    FastRandomContext frc{/*fDeterministic=*/true};
+    auto data{frc.randbytes<std::byte>(1 << 20)};
+    auto key{frc.randbytes<std::byte>(8)};
+
+    bench.batch(data.size()).unit("byte").run([&] {
+        util::Xor(data, key, /*key_offset=*/3);
+    });
+}
+
 BENCHMARK(Xor, benchmark::PriorityLevel::HIGH);
+BENCHMARK(XorObfuscationKey, benchmark::PriorityLevel::HIGH);
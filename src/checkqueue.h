@@ -11,8 +11,13 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <deque>
 #include <iterator>
 #include <optional>
+#include <span>
+#include <string>
 #include <vector>
 
 /**
@@ -23,16 +28,35 @@
   * The overall result of the computation is std::nullopt if all invocations
   * return std::nullopt, or one of the other results otherwise.
   *
+  * If T has a static BatchCheck(std::span<T>) returning std::optional<R>,
+  * each batch a worker takes from the queue is handed to it as a whole
+  * instead of being run one check at a time.
+  *
   * One thread (the master) is assumed to push batches of verifications
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
   *
+  * Every worker (including the master) has its own deque of checks, which
+  * Add() fills in turn. A worker takes batches from the back of its own
+  * deque, and steals from the front of the others' when it runs out, so
+  * the threads only contend when they touch the same deque. The shared
+  * mutex is only taken to go to sleep, to wake up the workers after Add(),
+  * and to report a failure or the completion of the last check.
+  *
   */
 template <typename T, typename R = std::remove_cvref_t<decltype(std::declval<T>()().value())>>
 class CCheckQueue
 {
 private:
+    //! The checks that are assigned to one worker, and that others may steal.
+    struct WorkerQueue {
+        Mutex m_mutex;
+        std::deque<T> checks GUARDED_BY(m_mutex);
+        //! Copy of checks.size(), to skip empty deques without locking them.
+        std::atomic<size_t> m_size{0};
+    };
+
     //! Mutex to protect the inner state
     Mutex m_mutex;
 
@@ -42,25 +66,28 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
+    //! One deque per worker thread, and the last one for the master.
+    std::vector<WorkerQueue> m_queues;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
+    //! The deque Add() starts filling next, to spread small batches over all workers.
+    size_t m_next_queue{0};
 
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
+    //! Incremented (with m_mutex held) after new checks were added. Sleeping
+    //! workers wait for it to change.
+    std::atomic<uint64_t> m_work_epoch{0};
 
     //! The temporary evaluation result.
     std::optional<R> m_result GUARDED_BY(m_mutex);
 
+    //! Whether a check failed, so the remaining ones can be skipped.
+    std::atomic<bool> m_failed{false};
+
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    std::atomic<size_t> m_todo{0};
 
     //! The maximum number of elements to be processed in one batch
     const unsigned int nBatchSize;
@@ -68,71 +95,79 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
-    /** Internal function that does bulk of the verification work. If fMaster, return the final result. */
-    std::optional<R> Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    /**
+     * Move a batch of checks into vChecks: from the back of the deque of
+     * worker index, or else from the front of another one. Returns false if
+     * all deques are empty.
+     */
+    bool TakeWork(size_t index, std::vector<T>& vChecks)
     {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        std::optional<R> local_result;
-        bool do_work;
-        do {
-            {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    if (local_result.has_value() && !m_result.has_value()) {
-                        std::swap(local_result, m_result);
-                    }
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster) {
-                        // We processed the last element; inform the master it can exit and return the result
-                        m_master_cv.notify_one();
-                    }
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        std::optional<R> to_return = std::move(m_result);
-                        // reset the status for new work later
-                        m_result = std::nullopt;
-                        // return the current status
-                        return to_return;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                if (m_request_stop) {
-                    // return value does not matter, because m_request_stop is only set in the destructor.
-                    return std::nullopt;
-                }
+        for (size_t i = 0; i < m_queues.size(); ++i) {
+            WorkerQueue& queue{m_queues[(index + i) % m_queues.size()]};
+            if (queue.m_size.load() == 0) continue;
+            LOCK(queue.m_mutex);
+            if (queue.checks.empty()) continue;
+            // Leave half of the checks for others to steal, so all workers
+            // finish approximately simultaneously. Don't do batches smaller
+            // than 1 (duh), or larger than nBatchSize.
+            const size_t now{std::max<size_t>(1, std::min<size_t>(nBatchSize, queue.checks.size() / 2))};
+            const auto begin_it{i == 0 ? queue.checks.end() - now : queue.checks.begin()};
+            vChecks.assign(std::make_move_iterator(begin_it), std::make_move_iterator(begin_it + now));
+            queue.checks.erase(begin_it, begin_it + now);
+            queue.m_size.store(queue.checks.size());
+            return true;
+        }
+        return false;
+    }
 
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                auto start_it = queue.end() - nNow;
-                vChecks.assign(std::make_move_iterator(start_it), std::make_move_iterator(queue.end()));
-                queue.erase(start_it, queue.end());
-                // Check whether we need to do work at all
-                do_work = !m_result.has_value();
-            }
-            // execute work
-            if (do_work) {
+    /** Run (unless an earlier check failed) and destroy the checks in vChecks. */
+    void RunChecks(std::vector<T>& vChecks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::optional<R> local_result;
+        if (!m_failed.load()) {
+            if constexpr (requires { { T::BatchCheck(std::span<T>{vChecks}) } -> std::same_as<std::optional<R>>; }) {
+                // T knows how to verify a batch more cheaply than one check at a time.
+                local_result = T::BatchCheck(vChecks);
+            } else {
                 for (T& check : vChecks) {
                     local_result = check();
                     if (local_result.has_value()) break;
                 }
             }
-            vChecks.clear();
+        }
+        const size_t done{vChecks.size()};
+        // The checks must be destroyed before they count as completed.
+        vChecks.clear();
+        if (local_result.has_value()) {
+            LOCK(m_mutex);
+            if (!m_result.has_value()) m_result = std::move(local_result);
+            m_failed.store(true);
+        }
+        if (m_todo.fetch_sub(done) == done) {
+            // We processed the last element; inform the master it can exit and return the result
+            LOCK(m_mutex);
+            m_master_cv.notify_one();
+        }
+    }
+
+    /** Internal function that does bulk of the verification work of worker thread index. */
+    void Loop(size_t index) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        do {
+            const uint64_t work_epoch{m_work_epoch.load()};
+            if (TakeWork(index, vChecks)) {
+                RunChecks(vChecks);
+                continue;
+            }
+            WAIT_LOCK(m_mutex, lock);
+            // Checks added after work_epoch was read may have been missed
+            // by TakeWork(), so only wait if there were none.
+            while (m_work_epoch.load() == work_epoch && !m_request_stop) {
+                m_worker_cv.wait(lock);
+            }
+            if (m_request_stop) return;
         } while (true);
     }
 
@@ -140,16 +175,15 @@ public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     Mutex m_control_mutex;
 
-    //! Create a new check queue
-    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num)
-        : nBatchSize(batch_size)
+    //! Create a new check queue. Worker threads are named after thread_name.
+    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num, const std::string& thread_name = "scriptch")
+        : m_queues(std::max(worker_threads_num, 0) + 1), nBatchSize(batch_size)
     {
-        LogInfo("Script verification uses %d additional threads", worker_threads_num);
         m_worker_threads.reserve(worker_threads_num);
         for (int n = 0; n < worker_threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                Loop(false /* worker thread */);
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                Loop(n);
             });
         }
     }
@@ -165,7 +199,22 @@ public:
     //! its error.
     std::optional<R> Complete() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        return Loop(true /* master thread */);
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        // Only the master adds checks, so once all deques are found empty
+        // they stay empty, and the rest is in the hands of the workers.
+        while (TakeWork(m_queues.size() - 1, vChecks)) {
+            RunChecks(vChecks);
+        }
+        WAIT_LOCK(m_mutex, lock);
+        while (m_todo.load() != 0) {
+            m_master_cv.wait(lock);
+        }
+        std::optional<R> to_return = std::move(m_result);
+        // reset the status for new work later
+        m_result = std::nullopt;
+        m_failed.store(false);
+        return to_return;
     }
 
     //! Add a batch of checks to the queue
@@ -175,12 +224,22 @@ public:
             return;
         }
 
-        {
-            LOCK(m_mutex);
-            queue.insert(queue.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
-            nTodo += vChecks.size();
+        // Count the checks first, so they cannot complete before they are counted.
+        m_todo.fetch_add(vChecks.size());
+        // Hand out contiguous runs of checks to as many deques as there are
+        // workers, continuing where the previous call stopped.
+        const size_t per_queue{(vChecks.size() + m_queues.size() - 1) / m_queues.size()};
+        for (auto it{vChecks.begin()}; it != vChecks.end();) {
+            const auto end_it{it + std::min<size_t>(per_queue, vChecks.end() - it)};
+            WorkerQueue& queue{m_queues[m_next_queue]};
+            m_next_queue = (m_next_queue + 1) % m_queues.size();
+            LOCK(queue.m_mutex);
+            queue.checks.insert(queue.checks.end(), std::make_move_iterator(it), std::make_move_iterator(end_it));
+            queue.m_size.store(queue.checks.size());
+            it = end_it;
         }
 
+        WITH_LOCK(m_mutex, m_work_epoch.fetch_add(1));
         if (vChecks.size() == 1) {
             m_worker_cv.notify_one();
         } else {
@@ -4,11 +4,17 @@
 
 #include <coins.h>
 
+#include <checkqueue.h>
 #include <consensus/consensus.h>
 #include <logging.h>
 #include <random.h>
 #include <util/trace.h>
 
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <vector>
+
 TRACEPOINT_SEMAPHORE(utxocache, add);
 TRACEPOINT_SEMAPHORE(utxocache, spent);
 TRACEPOINT_SEMAPHORE(utxocache, uncache);
@@ -18,6 +24,7 @@ uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
 bool CCoinsView::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) { return false; }
 std::unique_ptr<CCoinsViewCursor> CCoinsView::Cursor() const { return nullptr; }
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsView::SnapshotCursors(size_t count) const { return {}; }
 
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 {
@@ -48,6 +55,7 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     const auto [ret, inserted] = cacheCoins.try_emplace(outpoint);
     if (inserted) {
+        ++m_cache_misses;
         if (auto coin{base->GetCoin(outpoint)}) {
             ret->second.coin = std::move(*coin);
             cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
@@ -59,6 +67,8 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
             cacheCoins.erase(ret);
             return cacheCoins.end();
         }
+    } else {
+        ++m_cache_hits;
     }
     return ret;
 }
@@ -69,6 +79,15 @@ std::optional<Coin> CCoinsViewCache::GetCoin(const COutPoint& outpoint) const
     return std::nullopt;
 }
 
+std::optional<Coin> CCoinsViewCache::PeekCoin(const COutPoint& outpoint) const
+{
+    if (auto it{cacheCoins.find(outpoint)}; it != cacheCoins.end()) {
+        if (it->second.coin.IsSpent()) return std::nullopt;
+        return it->second.coin;
+    }
+    return base->PeekCoin(outpoint);
+}
+
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable()) return;
@@ -116,6 +135,37 @@ void CCoinsViewCache::EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coi
     if (inserted) CCoinsCacheEntry::SetDirty(*it, m_sentinel);
 }
 
+void CCoinsViewCache::EmplaceFetchedCoin(const COutPoint& outpoint, Coin&& coin)
+{
+    Assume(!coin.IsSpent());
+    const auto [it, inserted]{cacheCoins.try_emplace(outpoint, std::move(coin))};
+    if (inserted) cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+}
+
+void CCoinsViewCache::PrefetchCoins(std::span<const COutPoint> outpoints, CoinsFetchQueue& fetch_queue)
+{
+    std::vector<COutPoint> missing;
+    for (const COutPoint& outpoint : outpoints) {
+        if (!cacheCoins.contains(outpoint)) missing.push_back(outpoint);
+    }
+    if (missing.empty()) return;
+
+    // Results must stay in place until the queue has completed.
+    std::vector<std::optional<Coin>> coins(missing.size());
+    std::vector<CoinFetchJob> jobs;
+    jobs.reserve(missing.size());
+    for (size_t i{0}; i < missing.size(); ++i) {
+        jobs.emplace_back(*base, missing[i], coins[i]);
+    }
+    CCheckQueueControl<CoinFetchJob> control(&fetch_queue);
+    control.Add(std::move(jobs));
+    if (control.Complete()) return;
+
+    for (size_t i{0}; i < missing.size(); ++i) {
+        if (coins[i] && !coins[i]->IsSpent()) EmplaceFetchedCoin(missing[i], std::move(*coins[i]));
+    }
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check_for_overwrite) {
     bool fCoinbase = tx.IsCoinBase();
     const Txid& txid = tx.GetHash();
@@ -290,6 +340,74 @@ unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
 
+size_t CCoinsViewCache::GetDirtyCount() const
+{
+    size_t count{0};
+    for (auto it{m_sentinel.second.Next()}; it != &m_sentinel; it = it->second.Next()) {
+        if (it->second.IsDirty()) ++count;
+    }
+    return count;
+}
+
+size_t CCoinsViewCache::EvictOldestCoins(size_t max_usage)
+{
+    if (m_sentinel.second.Next() != &m_sentinel) return 0;
+    const size_t usage{DynamicMemoryUsage()};
+    if (usage <= max_usage || cacheCoins.empty()) return 0;
+
+    // Both the map nodes and the scripts scale roughly with the number of
+    // coins, so keep the matching share of the newest ones.
+    const size_t keep_count{static_cast<size_t>(static_cast<double>(cacheCoins.size()) * max_usage / usage)};
+    const size_t evict_count{cacheCoins.size() - keep_count};
+
+    // Find the height below which everything goes. Coins at exactly that
+    // height are kept until keep_count is reached. Counting per height needs
+    // memory only for the distinct heights, not for every coin.
+    std::map<uint32_t, size_t> height_counts;
+    for (const auto& [_, entry] : cacheCoins) ++height_counts[entry.coin.nHeight];
+    uint32_t cutoff{std::numeric_limits<uint32_t>::max()};
+    size_t keep_at_cutoff{0};
+    size_t evict_left{evict_count};
+    for (const auto& [height, count] : height_counts) {
+        if (count > evict_left) {
+            cutoff = height;
+            keep_at_cutoff = count - evict_left;
+            break;
+        }
+        evict_left -= count;
+    }
+    height_counts.clear();
+
+    // The map's memory is only returned once all of it is released, so the
+    // kept coins have to be moved out and back in. Drop the evicted coins
+    // while collecting, and move the kept ones in bounded batches that are
+    // freed one by one as they are reinserted.
+    static constexpr size_t BATCH_SIZE{1 << 16};
+    std::vector<std::vector<std::pair<COutPoint, Coin>>> kept;
+    size_t kept_count{0};
+    for (auto it{cacheCoins.begin()}; it != cacheCoins.end(); it = cacheCoins.erase(it)) {
+        const uint32_t height{it->second.coin.nHeight};
+        if (height < cutoff || (height == cutoff && keep_at_cutoff == 0)) continue;
+        if (height == cutoff) --keep_at_cutoff;
+        if (kept.empty() || kept.back().size() == BATCH_SIZE) kept.emplace_back().reserve(std::min(BATCH_SIZE, keep_count - kept_count));
+        kept.back().emplace_back(it->first, std::move(it->second.coin));
+        ++kept_count;
+    }
+
+    const size_t evicted{keep_count + evict_count - kept_count};
+    ReallocateCache();
+    cachedCoinsUsage = 0;
+    cacheCoins.reserve(kept_count);
+    for (auto& batch : kept) {
+        for (auto& [outpoint, coin] : batch) {
+            cachedCoinsUsage += coin.DynamicMemoryUsage();
+            cacheCoins.try_emplace(outpoint, std::move(coin));
+        }
+        batch = {};
+    }
+    return evicted;
+}
+
 bool CCoinsViewCache::HaveInputs(const CTransaction& tx) const
 {
     if (!tx.IsCoinBase()) {
@@ -359,6 +477,16 @@ const Coin& AccessByTxid(const CCoinsViewCache& view, const Txid& txid)
     return coinEmpty;
 }
 
+std::optional<std::string> CoinFetchJob::operator()()
+{
+    try {
+        *m_result = m_view->GetCoin(*m_outpoint);
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+    return std::nullopt;
+}
+
 template <typename ReturnType, typename Func>
 static ReturnType ExecuteBackedWrapper(Func func, const std::vector<std::function<void()>>& err_callbacks)
 {
@@ -20,8 +20,14 @@
 #include <stdint.h>
 
 #include <functional>
+#include <optional>
+#include <span>
+#include <string>
 #include <unordered_map>
 
+template <typename T, typename R>
+class CCheckQueue;
+
 /**
  * A UTXO entry.
  *
@@ -123,24 +129,34 @@ private:
      * CCoinsViewCache. Nevertheless, if a spent coin is retrieved from the
      * parent cache, the FRESH-but-not-DIRTY coin will be tracked by the linked
      * list and deleted when Sync or Flush is called on the CCoinsViewCache.
+     *
+     * The flags are kept in the low bits of the pointer to the next entry,
+     * which are always zero because pairs are pointer-aligned. A separate
+     * flags byte would be padded to a full word, so this saves 8 bytes in
+     * every cached coin.
      */
     CoinsCachePair* m_prev{nullptr};
-    CoinsCachePair* m_next{nullptr};
-    uint8_t m_flags{0};
+    uintptr_t m_next_and_flags{0};
+
+    static constexpr uintptr_t FLAGS_MASK{3};
+
+    uint8_t GetFlags() const noexcept { return m_next_and_flags & FLAGS_MASK; }
+    CoinsCachePair* GetNext() const noexcept { return reinterpret_cast<CoinsCachePair*>(m_next_and_flags & ~FLAGS_MASK); }
+    void SetNext(CoinsCachePair* next) noexcept { m_next_and_flags = reinterpret_cast<uintptr_t>(next) | GetFlags(); }
 
     //! Adding a flag requires a reference to the sentinel of the flagged pair linked list.
     static void AddFlags(uint8_t flags, CoinsCachePair& pair, CoinsCachePair& sentinel) noexcept
     {
         Assume(flags & (DIRTY | FRESH));
-        if (!pair.second.m_flags) {
-            Assume(!pair.second.m_prev && !pair.second.m_next);
+        if (!pair.second.GetFlags()) {
+            Assume(!pair.second.m_prev && !pair.second.GetNext());
             pair.second.m_prev = sentinel.second.m_prev;
-            pair.second.m_next = &sentinel;
+            pair.second.SetNext(&sentinel);
             sentinel.second.m_prev = &pair;
-            pair.second.m_prev->second.m_next = &pair;
+            pair.second.m_prev->second.SetNext(&pair);
         }
-        Assume(pair.second.m_prev && pair.second.m_next);
-        pair.second.m_flags |= flags;
+        Assume(pair.second.m_prev && pair.second.GetNext());
+        pair.second.m_next_and_flags |= flags;
     }
 
 public:
@@ -179,26 +195,26 @@ public:
 
     void SetClean() noexcept
     {
-        if (!m_flags) return;
-        m_next->second.m_prev = m_prev;
-        m_prev->second.m_next = m_next;
-        m_flags = 0;
-        m_prev = m_next = nullptr;
+        if (!GetFlags()) return;
+        GetNext()->second.m_prev = m_prev;
+        m_prev->second.SetNext(GetNext());
+        m_prev = nullptr;
+        m_next_and_flags = 0;
     }
-    bool IsDirty() const noexcept { return m_flags & DIRTY; }
-    bool IsFresh() const noexcept { return m_flags & FRESH; }
+    bool IsDirty() const noexcept { return m_next_and_flags & DIRTY; }
+    bool IsFresh() const noexcept { return m_next_and_flags & FRESH; }
 
     //! Only call Next when this entry is DIRTY, FRESH, or both
     CoinsCachePair* Next() const noexcept
     {
-        Assume(m_flags);
-        return m_next;
+        Assume(GetFlags());
+        return GetNext();
     }
 
     //! Only call Prev when this entry is DIRTY, FRESH, or both
     CoinsCachePair* Prev() const noexcept
     {
-        Assume(m_flags);
+        Assume(GetFlags());
         return m_prev;
     }
 
@@ -207,12 +223,13 @@ public:
     {
         Assume(&pair.second == this);
         m_prev = &pair;
-        m_next = &pair;
         // Set sentinel to DIRTY so we can call Next on it
-        m_flags = DIRTY;
+        m_next_and_flags = reinterpret_cast<uintptr_t>(&pair) | DIRTY;
     }
 };
 
+static_assert(alignof(CoinsCachePair) > CCoinsCacheEntry::DIRTY + CCoinsCacheEntry::FRESH, "flags must fit in the alignment bits of a pair pointer");
+
 /**
  * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
  * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
@@ -243,6 +260,11 @@ public:
     virtual bool Valid() const = 0;
     virtual void Next() = 0;
 
+    //! Move to the first coin of the first transaction whose txid is not
+    //! lower than the given one, in the order the cursor iterates in. Returns
+    //! false if the cursor does not support this.
+    virtual bool Seek(const Txid& txid) { return false; }
+
     //! Get best block at the time this cursor was created
     const uint256 &GetBestBlock() const { return hashBlock; }
 private:
@@ -312,6 +334,12 @@ public:
     //! Retrieve the Coin (unspent transaction output) for a given outpoint.
     virtual std::optional<Coin> GetCoin(const COutPoint& outpoint) const;
 
+    //! Like GetCoin(), but without populating any cache on the way. Multiple
+    //! threads may call this at the same time, as long as no view involved is
+    //! modified meanwhile and the views below the caches support concurrent
+    //! GetCoin() calls.
+    virtual std::optional<Coin> PeekCoin(const COutPoint& outpoint) const { return GetCoin(outpoint); }
+
     //! Just check whether a given outpoint is unspent.
     virtual bool HaveCoin(const COutPoint &outpoint) const;
 
@@ -331,6 +359,11 @@ public:
     //! Get a cursor to iterate over the whole state
     virtual std::unique_ptr<CCoinsViewCursor> Cursor() const;
 
+    //! Get several cursors like Cursor() that all iterate over the same state,
+    //! and support Seek(), so that ranges of it can be read on several threads
+    //! at once. Returns an empty vector if the view does not support this.
+    virtual std::vector<std::unique_ptr<CCoinsViewCursor>> SnapshotCursors(size_t count) const;
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() = default;
 
@@ -358,6 +391,27 @@ public:
 };
 
 
+/**
+ * Closure representing the lookup of one coin in a CCoinsView, to be run on a
+ * CCheckQueue. The view must support concurrent calls to GetCoin().
+ */
+class CoinFetchJob
+{
+private:
+    const CCoinsView* m_view;
+    const COutPoint* m_outpoint;
+    std::optional<Coin>* m_result;
+
+public:
+    CoinFetchJob(const CCoinsView& view LIFETIMEBOUND, const COutPoint& outpoint LIFETIMEBOUND, std::optional<Coin>& result LIFETIMEBOUND)
+        : m_view(&view), m_outpoint(&outpoint), m_result(&result) {}
+
+    //! Returns an error message if the lookup failed.
+    std::optional<std::string> operator()();
+};
+
+using CoinsFetchQueue = CCheckQueue<CoinFetchJob, std::string>;
+
 /** CCoinsView that adds a memory cache for transactions to another CCoinsView */
 class CCoinsViewCache : public CCoinsViewBacked
 {
@@ -378,6 +432,10 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage{0};
 
+    /* Number of lookups answered from the cache, and of those that had to go to the base view. */
+    mutable uint64_t m_cache_hits{0};
+    mutable uint64_t m_cache_misses{0};
+
 public:
     CCoinsViewCache(CCoinsView *baseIn, bool deterministic = false);
 
@@ -388,6 +446,7 @@ public:
 
     // Standard CCoinsView methods
     std::optional<Coin> GetCoin(const COutPoint& outpoint) const override;
+    std::optional<Coin> PeekCoin(const COutPoint& outpoint) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
@@ -430,6 +489,27 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Add an unspent coin that was retrieved from the backing view ahead of
+     * time, unless this cache already has an entry for the outpoint. The coin
+     * is not marked DIRTY or FRESH.
+     *
+     * The caller must ensure the coin still matches the backing view, so that
+     * the result is the same as if it had been fetched on first access.
+     */
+    void EmplaceFetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
+    /**
+     * Look up the given outpoints that are not in this cache yet in the
+     * backing view, spreading the lookups over the threads of fetch_queue,
+     * and add the coins that were found as if they had been fetched on first
+     * access. The backing view must support concurrent calls to GetCoin().
+     *
+     * If any lookup fails, no coins are added and the failing lookups are
+     * left to be retried on first access.
+     */
+    void PrefetchCoins(std::span<const COutPoint> outpoints, CoinsFetchQueue& fetch_queue);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -466,6 +546,27 @@ public:
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Count the entries that have not been written to the base view yet.
+    size_t GetDirtyCount() const;
+
+    //! Lookups served from the cache and lookups that had to consult the base view.
+    uint64_t GetCacheHits() const { return m_cache_hits; }
+    uint64_t GetCacheMisses() const { return m_cache_misses; }
+
+    /**
+     * Shrink a clean cache (i.e. right after Sync()) to at most roughly
+     * max_usage bytes by dropping the coins created at the lowest heights,
+     * which are the ones least likely to be spent soon. The remaining coins
+     * are moved into a freshly allocated map so that the memory is actually
+     * released.
+     *
+     * Does nothing if the cache holds unwritten changes or is already small
+     * enough.
+     *
+     * @return the number of coins dropped from the cache
+     */
+    size_t EvictOldestCoins(size_t max_usage);
+
     //! Check whether all prevouts of the transaction are present in the UTXO set represented by this view
     bool HaveInputs(const CTransaction& tx) const;
 
@@ -14,6 +14,8 @@
 #include <util/check.h>
 #include <util/moneystr.h>
 
+#include <type_traits>
+
 bool IsFinalTx(const CTransaction &tx, int nBlockHeight, int64_t nBlockTime)
 {
     if (tx.nLockTime == 0)
@@ -123,7 +125,12 @@ unsigned int GetLegacySigOpCount(const CTransaction& tx)
     return nSigOps;
 }
 
-unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& inputs)
+namespace {
+//! The coin spent by the i-th input of a transaction.
+template <typename F>
+concept SpentCoinGetter = std::is_invocable_r_v<const Coin&, F, size_t>;
+
+unsigned int GetP2SHSigOpCountImpl(const CTransaction& tx, SpentCoinGetter auto get_coin)
 {
     if (tx.IsCoinBase())
         return 0;
@@ -131,7 +138,7 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& in
     unsigned int nSigOps = 0;
     for (unsigned int i = 0; i < tx.vin.size(); i++)
     {
-        const Coin& coin = inputs.AccessCoin(tx.vin[i].prevout);
+        const Coin& coin = get_coin(i);
         assert(!coin.IsSpent());
         const CTxOut &prevout = coin.out;
         if (prevout.scriptPubKey.IsPayToScriptHash())
@@ -140,7 +147,7 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& in
     return nSigOps;
 }
 
-int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& inputs, uint32_t flags)
+int64_t GetTransactionSigOpCostImpl(const CTransaction& tx, SpentCoinGetter auto get_coin, uint32_t flags)
 {
     int64_t nSigOps = GetLegacySigOpCount(tx) * WITNESS_SCALE_FACTOR;
 
@@ -148,12 +155,12 @@ int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& i
         return nSigOps;
 
     if (flags & SCRIPT_VERIFY_P2SH) {
-        nSigOps += GetP2SHSigOpCount(tx, inputs) * WITNESS_SCALE_FACTOR;
+        nSigOps += GetP2SHSigOpCountImpl(tx, get_coin) * WITNESS_SCALE_FACTOR;
     }
 
     for (unsigned int i = 0; i < tx.vin.size(); i++)
     {
-        const Coin& coin = inputs.AccessCoin(tx.vin[i].prevout);
+        const Coin& coin = get_coin(i);
         assert(!coin.IsSpent());
         const CTxOut &prevout = coin.out;
         nSigOps += CountWitnessSigOps(tx.vin[i].scriptSig, prevout.scriptPubKey, &tx.vin[i].scriptWitness, flags);
@@ -161,18 +168,12 @@ int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& i
     return nSigOps;
 }
 
-bool Consensus::CheckTxInputs(const CTransaction& tx, TxValidationState& state, const CCoinsViewCache& inputs, int nSpendHeight, CAmount& txfee)
+//! CheckTxInputs() once all inputs are known to be available.
+bool CheckTxInputValues(const CTransaction& tx, TxValidationState& state, SpentCoinGetter auto get_coin, int nSpendHeight, CAmount& txfee)
 {
-    // are the actual inputs available?
-    if (!inputs.HaveInputs(tx)) {
-        return state.Invalid(TxValidationResult::TX_MISSING_INPUTS, "bad-txns-inputs-missingorspent",
-                         strprintf("%s: inputs missing/spent", __func__));
-    }
-
     CAmount nValueIn = 0;
     for (unsigned int i = 0; i < tx.vin.size(); ++i) {
-        const COutPoint &prevout = tx.vin[i].prevout;
-        const Coin& coin = inputs.AccessCoin(prevout);
+        const Coin& coin = get_coin(i);
         assert(!coin.IsSpent());
 
         // If prev is coinbase, check that it's matured
@@ -203,3 +204,37 @@ bool Consensus::CheckTxInputs(const CTransaction& tx, TxValidationState& state,
     txfee = txfee_aux;
     return true;
 }
+} // namespace
+
+unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& inputs)
+{
+    return GetP2SHSigOpCountImpl(tx, [&](size_t i) -> const Coin& { return inputs.AccessCoin(tx.vin[i].prevout); });
+}
+
+int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& inputs, uint32_t flags)
+{
+    return GetTransactionSigOpCostImpl(tx, [&](size_t i) -> const Coin& { return inputs.AccessCoin(tx.vin[i].prevout); }, flags);
+}
+
+int64_t GetTransactionSigOpCost(const CTransaction& tx, std::span<const Coin> spent_coins, uint32_t flags)
+{
+    assert(tx.IsCoinBase() || spent_coins.size() == tx.vin.size());
+    return GetTransactionSigOpCostImpl(tx, [&](size_t i) -> const Coin& { return spent_coins[i]; }, flags);
+}
+
+bool Consensus::CheckTxInputs(const CTransaction& tx, TxValidationState& state, const CCoinsViewCache& inputs, int nSpendHeight, CAmount& txfee)
+{
+    // are the actual inputs available?
+    if (!inputs.HaveInputs(tx)) {
+        return state.Invalid(TxValidationResult::TX_MISSING_INPUTS, "bad-txns-inputs-missingorspent",
+                         strprintf("%s: inputs missing/spent", __func__));
+    }
+
+    return CheckTxInputValues(tx, state, [&](size_t i) -> const Coin& { return inputs.AccessCoin(tx.vin[i].prevout); }, nSpendHeight, txfee);
+}
+
+bool Consensus::CheckTxInputs(const CTransaction& tx, TxValidationState& state, std::span<const Coin> spent_coins, int nSpendHeight, CAmount& txfee)
+{
+    assert(spent_coins.size() == tx.vin.size());
+    return CheckTxInputValues(tx, state, [&](size_t i) -> const Coin& { return spent_coins[i]; }, nSpendHeight, txfee);
+}
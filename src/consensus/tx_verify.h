@@ -8,10 +8,12 @@
 #include <consensus/amount.h>
 
 #include <stdint.h>
+#include <span>
 #include <vector>
 
 class CBlockIndex;
 class CCoinsViewCache;
+class Coin;
 class CTransaction;
 class TxValidationState;
 
@@ -25,6 +27,12 @@ namespace Consensus {
  * Preconditions: tx.IsCoinBase() is false.
  */
 [[nodiscard]] bool CheckTxInputs(const CTransaction& tx, TxValidationState& state, const CCoinsViewCache& inputs, int nSpendHeight, CAmount& txfee);
+
+/**
+ * Same as above, for a transaction whose inputs have already been looked up.
+ * @param[in] spent_coins The unspent coin for every input of tx, in input order.
+ */
+[[nodiscard]] bool CheckTxInputs(const CTransaction& tx, TxValidationState& state, std::span<const Coin> spent_coins, int nSpendHeight, CAmount& txfee);
 } // namespace Consensus
 
 /** Auxiliary functions for transaction validation (ideally should not be exposed) */
@@ -54,6 +62,11 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& ma
  */
 int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& inputs, uint32_t flags);
 
+/**
+ * Same as above, with the coin spent by every input of tx given in input order.
+ */
+int64_t GetTransactionSigOpCost(const CTransaction& tx, std::span<const Coin> spent_coins, uint32_t flags);
+
 /**
  * Check if transaction is final and can be included in a block with the
  * specified height and time. Consensus critical.
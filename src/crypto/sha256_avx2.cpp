@@ -45,16 +45,16 @@ void ALWAYS_INLINE Round(__m256i a, __m256i b, __m256i c, __m256i& d, __m256i e,
     h = Add(t1, t2);
 }
 
-__m256i inline Read8(const unsigned char* chunk, int offset) {
+__m256i inline Read8(const unsigned char* chunk, int offset, int stride = 64) {
     __m256i ret = _mm256_set_epi32(
         ReadLE32(chunk + 0 + offset),
-        ReadLE32(chunk + 64 + offset),
-        ReadLE32(chunk + 128 + offset),
-        ReadLE32(chunk + 192 + offset),
-        ReadLE32(chunk + 256 + offset),
-        ReadLE32(chunk + 320 + offset),
-        ReadLE32(chunk + 384 + offset),
-        ReadLE32(chunk + 448 + offset)
+        ReadLE32(chunk + 1 * stride + offset),
+        ReadLE32(chunk + 2 * stride + offset),
+        ReadLE32(chunk + 3 * stride + offset),
+        ReadLE32(chunk + 4 * stride + offset),
+        ReadLE32(chunk + 5 * stride + offset),
+        ReadLE32(chunk + 6 * stride + offset),
+        ReadLE32(chunk + 7 * stride + offset)
     );
     return _mm256_shuffle_epi8(ret, _mm256_set_epi32(0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL, 0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL));
 }
@@ -71,6 +71,56 @@ void inline Write8(unsigned char* out, int offset, __m256i v) {
     WriteLE32(out + 224 + offset, _mm256_extract_epi32(v, 0));
 }
 
+/** The SHA-256 round constants. */
+constexpr uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+};
+
+/** The message word for round i, extending the message schedule in w in place from round 16 on. */
+__m256i inline Msg(__m256i* w, int i)
+{
+    if (i >= 16) Inc(w[i & 15], sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]));
+    return w[i & 15];
+}
+
+/** Run the 64 rounds of SHA-256 over the message words in w (overwriting them), and add the result to the state s. */
+void ALWAYS_INLINE Compress(__m256i* s, __m256i* w)
+{
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    for (int i = 0; i < 64; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(ROUND_CONSTANTS[i + 0]), Msg(w, i + 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(ROUND_CONSTANTS[i + 1]), Msg(w, i + 1)));
+        Round(g, h, a, b, c, d, e, f, Add(K(ROUND_CONSTANTS[i + 2]), Msg(w, i + 2)));
+        Round(f, g, h, a, b, c, d, e, Add(K(ROUND_CONSTANTS[i + 3]), Msg(w, i + 3)));
+        Round(e, f, g, h, a, b, c, d, Add(K(ROUND_CONSTANTS[i + 4]), Msg(w, i + 4)));
+        Round(d, e, f, g, h, a, b, c, Add(K(ROUND_CONSTANTS[i + 5]), Msg(w, i + 5)));
+        Round(c, d, e, f, g, h, a, b, Add(K(ROUND_CONSTANTS[i + 6]), Msg(w, i + 6)));
+        Round(b, c, d, e, f, g, h, a, Add(K(ROUND_CONSTANTS[i + 7]), Msg(w, i + 7)));
+    }
+    Inc(s[0], a); Inc(s[1], b); Inc(s[2], c); Inc(s[3], d);
+    Inc(s[4], e); Inc(s[5], f); Inc(s[6], g); Inc(s[7], h);
+}
+
+/** Set the state to the SHA-256 initial values. */
+void inline Initialize(__m256i* s)
+{
+    s[0] = K(0x6a09e667ul);
+    s[1] = K(0xbb67ae85ul);
+    s[2] = K(0x3c6ef372ul);
+    s[3] = K(0xa54ff53aul);
+    s[4] = K(0x510e527ful);
+    s[5] = K(0x9b05688cul);
+    s[6] = K(0x1f83d9abul);
+    s[7] = K(0x5be0cd19ul);
+}
+
 }
 
 void Transform_8way(unsigned char* out, const unsigned char* in)
@@ -324,6 +374,34 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
     Write8(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+void TransformD80_8way(unsigned char* out, const unsigned char* in)
+{
+    __m256i s[8], w[16];
+
+    // Transform 1: the first 64 bytes of each input.
+    Initialize(s);
+    for (int i = 0; i < 16; ++i) w[i] = Read8(in, 4 * i, 80);
+    Compress(s, w);
+
+    // Transform 2: the last 16 bytes, and the padding for an 80-byte message.
+    for (int i = 0; i < 4; ++i) w[i] = Read8(in, 64 + 4 * i, 80);
+    w[4] = K(0x80000000ul);
+    for (int i = 5; i < 15; ++i) w[i] = K(0);
+    w[15] = K(640);
+    Compress(s, w);
+
+    // Transform 3: the first hash, and the padding for a 32-byte message.
+    for (int i = 0; i < 8; ++i) w[i] = s[i];
+    w[8] = K(0x80000000ul);
+    for (int i = 9; i < 15; ++i) w[i] = K(0);
+    w[15] = K(256);
+    Initialize(s);
+    Compress(s, w);
+
+    // Output
+    for (int i = 0; i < 8; ++i) Write8(out, 4 * i, s[i]);
+}
+
 }
 
 #endif
@@ -396,6 +396,29 @@ CDBIterator* CDBWrapper::NewIterator()
     return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(DBContext().iteroptions))};
 }
 
+struct CDBSnapshot::SnapshotImpl {
+    leveldb::DB* const db;
+    const leveldb::Snapshot* const snapshot;
+
+    explicit SnapshotImpl(leveldb::DB* _db) : db{_db}, snapshot{_db->GetSnapshot()} {}
+    ~SnapshotImpl() { db->ReleaseSnapshot(snapshot); }
+};
+
+CDBSnapshot::CDBSnapshot(std::unique_ptr<SnapshotImpl> impl) : m_impl{std::move(impl)} {}
+CDBSnapshot::~CDBSnapshot() = default;
+
+std::shared_ptr<const CDBSnapshot> CDBWrapper::NewSnapshot()
+{
+    return std::make_shared<const CDBSnapshot>(std::make_unique<CDBSnapshot::SnapshotImpl>(DBContext().pdb));
+}
+
+CDBIterator* CDBWrapper::NewIterator(const CDBSnapshot& snapshot)
+{
+    leveldb::ReadOptions options{DBContext().iteroptions};
+    options.snapshot = snapshot.m_impl->snapshot;
+    return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(options))};
+}
+
 void CDBIterator::SeekImpl(Span<const std::byte> key)
 {
     leveldb::Slice slKey(CharCast(key.data()), key.size());
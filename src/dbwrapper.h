@@ -120,6 +120,20 @@ public:
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/**
+ * A consistent view of the database as it was when the snapshot was taken,
+ * for iterators that have to agree with each other. See CDBWrapper::NewSnapshot().
+ */
+class CDBSnapshot
+{
+public:
+    struct SnapshotImpl;
+    const std::unique_ptr<SnapshotImpl> m_impl;
+
+    explicit CDBSnapshot(std::unique_ptr<SnapshotImpl> impl);
+    ~CDBSnapshot();
+};
+
 class CDBIterator
 {
 public:
@@ -278,6 +292,13 @@ public:
 
     CDBIterator* NewIterator();
 
+    //! Take a snapshot of the current state of the database.
+    std::shared_ptr<const CDBSnapshot> NewSnapshot();
+
+    //! Get an iterator over the database as it was when the snapshot was
+    //! taken. The snapshot must outlive the iterator.
+    CDBIterator* NewIterator(const CDBSnapshot& snapshot);
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -114,7 +114,7 @@ CoinStatsIndex::CoinStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t
 
 bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 {
-    CBlockUndo block_undo;
+    std::unique_ptr<node::BlockUndoCursor> undo_cursor;
     const CAmount block_subsidy{GetBlockSubsidy(block.height, Params().GetConsensus())};
     m_total_subsidy += block_subsidy;
 
@@ -123,7 +123,8 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
         // pindex variable gives indexing code access to node internals. It
         // will be removed in upcoming commit
         const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
-        if (!m_chainstate->m_blockman.UndoReadFromDisk(block_undo, *pindex)) {
+        undo_cursor = m_chainstate->m_blockman.OpenUndoCursor(*pindex);
+        if (!undo_cursor) {
             return false;
         }
 
@@ -183,7 +184,10 @@ bool CoinStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
 
             // The coinbase tx has no undo data since no former output is spent
             if (!tx->IsCoinBase()) {
-                const auto& tx_undo{block_undo.vtxundo.at(i - 1)};
+                CTxUndo tx_undo;
+                if (!undo_cursor->ReadTxUndo(i - 1, tx_undo)) {
+                    return false;
+                }
 
                 for (size_t j = 0; j < tx_undo.vprevout.size(); ++j) {
                     Coin coin{tx_undo.vprevout[j]};
@@ -407,7 +411,7 @@ bool CoinStatsIndex::CustomCommit(CDBBatch& batch)
 // Reverse a single block as part of a reorg
 bool CoinStatsIndex::ReverseBlock(const CBlock& block, const CBlockIndex* pindex)
 {
-    CBlockUndo block_undo;
+    std::unique_ptr<node::BlockUndoCursor> undo_cursor;
     std::pair<uint256, DBVal> read_out;
 
     const CAmount block_subsidy{GetBlockSubsidy(pindex->nHeight, Params().GetConsensus())};
@@ -415,7 +419,8 @@ bool CoinStatsIndex::ReverseBlock(const CBlock& block, const CBlockIndex* pindex
 
     // Ignore genesis block
     if (pindex->nHeight > 0) {
-        if (!m_chainstate->m_blockman.UndoReadFromDisk(block_undo, *pindex)) {
+        undo_cursor = m_chainstate->m_blockman.OpenUndoCursor(*pindex);
+        if (!undo_cursor) {
             return false;
         }
 
@@ -467,7 +472,10 @@ bool CoinStatsIndex::ReverseBlock(const CBlock& block, const CBlockIndex* pindex
 
         // The coinbase tx has no undo data since no former output is spent
         if (!tx->IsCoinBase()) {
-            const auto& tx_undo{block_undo.vtxundo.at(i - 1)};
+            CTxUndo tx_undo;
+            if (!undo_cursor->ReadTxUndo(i - 1, tx_undo)) {
+                return false;
+            }
 
             for (size_t j = 0; j < tx_undo.vprevout.size(); ++j) {
                 Coin coin{tx_undo.vprevout[j]};
@@ -15,6 +15,9 @@ class CChainParams;
 namespace kernel {
 
 static constexpr bool DEFAULT_XOR_BLOCKSDIR{true};
+static constexpr bool DEFAULT_BLOCKS_MMAP{false};
+static constexpr bool DEFAULT_BLOCK_INDEX_SNAPSHOT{false};
+static constexpr int DEFAULT_REINDEX_THREADS{0};
 
 /**
  * An options struct for `BlockManager`, more ergonomically referred to as
@@ -23,6 +26,12 @@ static constexpr bool DEFAULT_XOR_BLOCKSDIR{true};
 struct BlockManagerOpts {
     const CChainParams& chainparams;
     bool use_xor{DEFAULT_XOR_BLOCKSDIR};
+    //! Read blocks from files that are no longer written to through a read-only memory map
+    bool use_mmap{DEFAULT_BLOCKS_MMAP};
+    //! Write the block index to a snapshot file on shutdown, and load it from there on startup
+    bool use_index_snapshot{DEFAULT_BLOCK_INDEX_SNAPSHOT};
+    //! Number of threads reading block files ahead during -reindex (0 = read them in order on the loading thread)
+    int reindex_threads{DEFAULT_REINDEX_THREADS};
     uint64_t prune_target{0};
     bool fast_prune{false};
     const fs::path blocks_dir;
@@ -23,6 +23,11 @@ class ValidationSignals;
 
 static constexpr bool DEFAULT_CHECKPOINTS_ENABLED{true};
 static constexpr auto DEFAULT_MAX_TIP_AGE{24h};
+static constexpr bool DEFAULT_BLOCK_PREFETCH{false};
+static constexpr int DEFAULT_COINS_PREFETCH_THREADS{0};
+static constexpr int DEFAULT_TX_PRECHECK_THREADS{0};
+static constexpr int DEFAULT_COINS_CACHE_RETAIN_PERCENT{0};
+static constexpr int MAX_COINS_CACHE_RETAIN_PERCENT{80};
 
 namespace kernel {
 
@@ -49,6 +54,21 @@ struct ChainstateManagerOpts {
     ValidationSignals* signals{nullptr};
     //! Number of script check worker threads. Zero means no parallel verification.
     int worker_threads_num{0};
+    //! Whether to read the next block to connect, and the coins it spends, in
+    //! the background while the current block is being connected.
+    bool block_prefetch{DEFAULT_BLOCK_PREFETCH};
+    //! Number of threads looking up the inputs of a block in the coins
+    //! database before it is connected. Zero means inputs are fetched on
+    //! first access.
+    int coins_prefetch_threads{DEFAULT_COINS_PREFETCH_THREADS};
+    //! Number of worker threads checking the inputs of the transactions of a
+    //! block that do not depend on each other before it is connected. Zero
+    //! means inputs are checked in order while connecting the block.
+    int tx_precheck_threads{DEFAULT_TX_PRECHECK_THREADS};
+    //! Share of the coins cache (in percent) to keep populated with the most
+    //! recently created coins when the coins cache is written because it is
+    //! full. Zero empties the cache on such flushes.
+    int coins_cache_retain_percent{DEFAULT_COINS_CACHE_RETAIN_PERCENT};
     size_t script_execution_cache_bytes{DEFAULT_SCRIPT_EXECUTION_CACHE_BYTES};
     size_t signature_cache_bytes{DEFAULT_SIGNATURE_CACHE_BYTES};
 };
@@ -20,15 +20,22 @@
 #include <uint256.h>
 #include <util/check.h>
 #include <util/overflow.h>
+#include <util/threadnames.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
 #include <iosfwd>
 #include <iterator>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace kernel {
 
@@ -55,7 +62,7 @@ static void TxOutSer(T& ss, const COutPoint& outpoint, const Coin& coin)
     ss << coin.out;
 }
 
-static void ApplyCoinHash(HashWriter& ss, const COutPoint& outpoint, const Coin& coin)
+void ApplyCoinHash(HashWriter& ss, const COutPoint& outpoint, const Coin& coin)
 {
     TxOutSer(ss, outpoint, coin);
 }
@@ -74,6 +81,11 @@ void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& c
     muhash.Remove(MakeUCharSpan(ss));
 }
 
+static void ApplyCoinHash(DataStream& ss, const COutPoint& outpoint, const Coin& coin)
+{
+    TxOutSer(ss, outpoint, coin);
+}
+
 static void ApplyCoinHash(std::nullptr_t, const COutPoint& outpoint, const Coin& coin) {}
 
 //! Warning: be very careful when changing this! assumeutxo and UTXO snapshot
@@ -111,20 +123,19 @@ static void ApplyStats(CCoinsStats& stats, const uint256& hash, const std::map<u
     }
 }
 
-//! Calculate statistics about the unspent transaction output set
+//! Add the coins from the cursor position up to the first transaction whose
+//! txid is not lower than end (or to the end of the view) to the statistics.
 template <typename T>
-static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point)
+static bool ApplyCoins(CCoinsViewCursor& cursor, const std::optional<Txid>& end, CCoinsStats& stats, T& hash_obj, const std::function<void()>& interruption_point)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
-
     Txid prevkey;
     std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
+    while (cursor.Valid()) {
         if (interruption_point) interruption_point();
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+        if (cursor.GetKey(key) && cursor.GetValue(coin)) {
+            if (end && !(key.hash < *end)) break;
             if (!outputs.empty() && key.hash != prevkey) {
                 ApplyStats(stats, prevkey, outputs);
                 ApplyHash(hash_obj, prevkey, outputs);
@@ -137,12 +148,177 @@ static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, c
             LogError("%s: unable to read value\n", __func__);
             return false;
         }
-        pcursor->Next();
+        cursor.Next();
     }
     if (!outputs.empty()) {
         ApplyStats(stats, prevkey, outputs);
         ApplyHash(hash_obj, prevkey, outputs);
     }
+    return true;
+}
+
+//! Maximum number of threads the UTXO set is read on.
+static constexpr unsigned int MAX_UTXO_READ_THREADS{8};
+
+Txid UTXOSetRangeStart(size_t range)
+{
+    uint256 start;
+    start.begin()[0] = range >> 4;
+    start.begin()[1] = (range & 0xf) << 4;
+    return Txid::FromUint256(start);
+}
+
+namespace {
+struct UTXOSetRangesWork {
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    //! The next range to read.
+    size_t m_next_range GUARDED_BY(m_mutex){0};
+    //! Number of ranges that were consumed so far.
+    size_t m_consumed GUARDED_BY(m_mutex){0};
+    //! Whether each range was read.
+    std::vector<bool> m_read GUARDED_BY(m_mutex) = std::vector<bool>(UTXO_SET_RANGES);
+    bool m_failed GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+};
+} // namespace
+
+bool ReadUTXOSetRanges(std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors, const std::string& thread_name,
+                       const std::function<bool(CCoinsViewCursor& cursor, const std::optional<Txid>& end, size_t range)>& read_range,
+                       const std::function<void(size_t range)>& consume_range,
+                       const std::function<void()>& interruption_point)
+{
+    UTXOSetRangesWork work;
+    const size_t max_ahead{2 * cursors.size()};
+
+    std::vector<std::thread> threads;
+    threads.reserve(cursors.size());
+    for (size_t n = 0; n < cursors.size(); ++n) {
+        threads.emplace_back([&, &cursor = *cursors[n], n]() {
+            util::ThreadRename(strprintf("%s.%i", thread_name, n));
+            while (true) {
+                size_t range;
+                {
+                    WAIT_LOCK(work.m_mutex, lock);
+                    work.m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(work.m_mutex) {
+                        return work.m_stop || work.m_next_range == UTXO_SET_RANGES || work.m_next_range < work.m_consumed + max_ahead;
+                    });
+                    if (work.m_stop || work.m_next_range == UTXO_SET_RANGES) return;
+                    range = work.m_next_range++;
+                }
+                std::optional<Txid> end;
+                if (range + 1 < UTXO_SET_RANGES) end = UTXOSetRangeStart(range + 1);
+                bool ok{false};
+                try {
+                    ok = cursor.Seek(UTXOSetRangeStart(range)) && read_range(cursor, end, range);
+                } catch (const std::exception& e) {
+                    LogError("%s: %s\n", __func__, e.what());
+                }
+                {
+                    LOCK(work.m_mutex);
+                    if (ok) {
+                        work.m_read[range] = true;
+                    } else {
+                        work.m_failed = true;
+                    }
+                }
+                work.m_cv.notify_all();
+            }
+        });
+    }
+
+    bool success{true};
+    std::exception_ptr error;
+    try {
+        for (size_t range = 0; range < UTXO_SET_RANGES; ++range) {
+            if (interruption_point) interruption_point();
+            {
+                WAIT_LOCK(work.m_mutex, lock);
+                work.m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(work.m_mutex) {
+                    return work.m_failed || work.m_read[range];
+                });
+                if (work.m_failed) {
+                    success = false;
+                    break;
+                }
+            }
+            consume_range(range);
+            WITH_LOCK(work.m_mutex, work.m_consumed = range + 1);
+            work.m_cv.notify_all();
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    WITH_LOCK(work.m_mutex, work.m_stop = true);
+    work.m_cv.notify_all();
+    for (std::thread& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+    return success;
+}
+
+//! Statistics of a range of the UTXO set. The serialized hash has to see the
+//! coins in order, so the range keeps them serialized until the ranges before
+//! it have been hashed; a MuHash of the range is simply combined with the
+//! others.
+template <typename T>
+struct UTXOStatsRange {
+    CCoinsStats stats;
+    std::conditional_t<std::is_same_v<T, HashWriter>, DataStream, T> hash_obj{};
+};
+
+static void CombineHash(HashWriter& ss, const DataStream& range) { ss.write(range); }
+static void CombineHash(MuHash3072& muhash, const MuHash3072& range) { muhash *= range; }
+static void CombineHash(std::nullptr_t, std::nullptr_t) {}
+
+static void CombineStats(CCoinsStats& stats, const CCoinsStats& range)
+{
+    stats.nTransactions += range.nTransactions;
+    stats.nTransactionOutputs += range.nTransactionOutputs;
+    stats.nBogoSize += range.nBogoSize;
+    stats.coins_count += range.coins_count;
+    if (stats.total_amount.has_value() && range.total_amount.has_value()) {
+        stats.total_amount = CheckedAdd(*stats.total_amount, *range.total_amount);
+    } else {
+        stats.total_amount = std::nullopt;
+    }
+}
+
+//! Compute the statistics of the ranges of the view on one thread per cursor,
+//! and combine them in order on this thread.
+template <typename T>
+static bool ComputeUTXOStatsParallel(std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors, CCoinsStats& stats, T& hash_obj, const std::function<void()>& interruption_point)
+{
+    std::vector<std::optional<UTXOStatsRange<T>>> ranges(UTXO_SET_RANGES);
+    return ReadUTXOSetRanges(
+        cursors, "coinstats",
+        [&](CCoinsViewCursor& cursor, const std::optional<Txid>& end, size_t range) {
+            auto& result{ranges[range].emplace()};
+            return ApplyCoins(cursor, end, result.stats, result.hash_obj, {});
+        },
+        [&](size_t range) {
+            CombineStats(stats, ranges[range]->stats);
+            CombineHash(hash_obj, ranges[range]->hash_obj);
+            ranges[range].reset();
+        },
+        interruption_point);
+}
+
+//! Calculate statistics about the unspent transaction output set
+template <typename T>
+static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point, unsigned int num_threads)
+{
+    num_threads = std::clamp(num_threads, 1U, MAX_UTXO_READ_THREADS);
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    if (num_threads > 1) cursors = view->SnapshotCursors(num_threads);
+
+    if (!cursors.empty()) {
+        if (!ComputeUTXOStatsParallel(cursors, stats, hash_obj, interruption_point)) return false;
+    } else {
+        std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+        assert(pcursor);
+        if (!ApplyCoins(*pcursor, std::nullopt, stats, hash_obj, interruption_point)) return false;
+    }
 
     FinalizeHash(hash_obj, stats);
 
@@ -151,7 +327,12 @@ static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, c
     return true;
 }
 
-std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsView* view, node::BlockManager& blockman, const std::function<void()>& interruption_point)
+unsigned int DefaultUTXOReadThreads()
+{
+    return std::clamp(std::thread::hardware_concurrency(), 1U, MAX_UTXO_READ_THREADS);
+}
+
+std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsView* view, node::BlockManager& blockman, const std::function<void()>& interruption_point, unsigned int num_threads)
 {
     CBlockIndex* pindex = WITH_LOCK(::cs_main, return blockman.LookupBlockIndex(view->GetBestBlock()));
     CCoinsStats stats{Assert(pindex)->nHeight, pindex->GetBlockHash()};
@@ -160,14 +341,14 @@ std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsV
         switch (hash_type) {
         case(CoinStatsHashType::HASH_SERIALIZED): {
             HashWriter ss{};
-            return ComputeUTXOStats(view, stats, ss, interruption_point);
+            return ComputeUTXOStats(view, stats, ss, interruption_point, num_threads);
         }
         case(CoinStatsHashType::MUHASH): {
             MuHash3072 muhash;
-            return ComputeUTXOStats(view, stats, muhash, interruption_point);
+            return ComputeUTXOStats(view, stats, muhash, interruption_point, num_threads);
         }
         case(CoinStatsHashType::NONE): {
-            return ComputeUTXOStats(view, stats, nullptr, interruption_point);
+            return ComputeUTXOStats(view, stats, nullptr, interruption_point, num_threads);
         }
         } // no default case, so the compiler can warn about missing cases
         assert(false);
@@ -9,15 +9,22 @@
 #include <crypto/muhash.h>
 #include <streams.h>
 #include <uint256.h>
+#include <util/transaction_identifier.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 class CCoinsView;
+class CCoinsViewCursor;
 class Coin;
 class COutPoint;
 class CScript;
+class HashWriter;
 namespace node {
 class BlockManager;
 } // namespace node
@@ -73,10 +80,46 @@ struct CCoinsStats {
 
 uint64_t GetBogoSize(const CScript& script_pub_key);
 
+void ApplyCoinHash(HashWriter& ss, const COutPoint& outpoint, const Coin& coin);
 void ApplyCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
 void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
 
-std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsView* view, node::BlockManager& blockman, const std::function<void()>& interruption_point = {});
+//! Number of ranges of txids the coins database is split into to read it on
+//! several threads. Ranges start at 12-bit txid prefixes.
+static constexpr size_t UTXO_SET_RANGES{4096};
+
+//! First txid of a range, in the order of the coins database keys.
+Txid UTXOSetRangeStart(size_t range);
+
+//! Number of threads the UTXO set is read on by default: one per core, up to a limit.
+unsigned int DefaultUTXOReadThreads();
+
+/**
+ * Read all UTXO_SET_RANGES ranges of the UTXO set with one thread per cursor,
+ * and consume them in order on the calling thread. Threads only read a
+ * bounded number of ranges ahead of the ones consumed, which bounds the
+ * memory held by ranges waiting to be consumed.
+ *
+ * @param[in] cursors        Cursors over the same snapshot of the view, e.g. from SnapshotCursors()
+ * @param[in] thread_name    Prefix of the names of the threads
+ * @param[in] read_range     Called on the thread of the cursor, which is positioned at the start of
+ *                           the range, to read it up to the first txid not lower than end (or to
+ *                           the end of the view). Returns false on failure.
+ * @param[in] consume_range  Called on the calling thread for every range, in order, once it was read
+ * @returns false if a range could not be read. Exceptions thrown by
+ *          consume_range or interruption_point are passed on once the threads stopped.
+ */
+bool ReadUTXOSetRanges(std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors, const std::string& thread_name,
+                       const std::function<bool(CCoinsViewCursor& cursor, const std::optional<Txid>& end, size_t range)>& read_range,
+                       const std::function<void(size_t range)>& consume_range,
+                       const std::function<void()>& interruption_point = {});
+
+/**
+ * Compute statistics about the UTXO set of the view. If num_threads is more
+ * than one and the view provides snapshot cursors, the view is read on that
+ * many threads, with the same result.
+ */
+std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsView* view, node::BlockManager& blockman, const std::function<void()>& interruption_point = {}, unsigned int num_threads = DefaultUTXOReadThreads());
 } // namespace kernel
 
 #endif // BITCOIN_KERNEL_COINSTATS_H
@@ -25,6 +25,8 @@ static constexpr unsigned int DEFAULT_MEMPOOL_EXPIRY_HOURS{336};
 static constexpr bool DEFAULT_PERSIST_V1_DAT{false};
 /** Default for -acceptnonstdtxn */
 static constexpr bool DEFAULT_ACCEPT_NON_STD_TXN{false};
+/** Default for -clustermempool, whether to order transactions by the chunks of their cluster's linearization */
+static constexpr bool DEFAULT_CLUSTER_MEMPOOL{false};
 
 namespace kernel {
 /**
@@ -54,6 +56,12 @@ struct MemPoolOptions {
     bool permit_bare_multisig{DEFAULT_PERMIT_BAREMULTISIG};
     bool require_standard{true};
     bool persist_v1_dat{DEFAULT_PERSIST_V1_DAT};
+    /**
+     * Whether to keep a linearization of every cluster of transactions, and
+     * use the feerates of its chunks for mining, eviction and replacement
+     * decisions instead of ancestor and descendant feerates.
+     */
+    bool cluster_mempool{DEFAULT_CLUSTER_MEMPOOL};
     MemPoolLimits limits{};
 
     ValidationSignals* signals{nullptr};
@@ -31,6 +31,7 @@
 #include <util/check.h>
 #include <util/sock.h>
 #include <util/threadinterrupt.h>
+#include <util/vector.h>
 
 #include <atomic>
 #include <condition_variable>
@@ -124,12 +125,33 @@ struct CSerializedNetMsg {
         CSerializedNetMsg copy;
         copy.data = data;
         copy.m_type = m_type;
+        copy.m_payload_owner = m_payload_owner;
+        copy.m_payload_view = m_payload_view;
         return copy;
     }
 
     std::vector<unsigned char> data;
     std::string m_type;
 
+    /**
+     * If set, the payload is m_payload_view instead of data. The viewed bytes
+     * stay valid for as long as m_payload_owner is held, which allows sending
+     * e.g. a block straight from a memory-mapped block file.
+     */
+    std::shared_ptr<const void> m_payload_owner;
+    Span<const unsigned char> m_payload_view;
+
+    /** The payload to send: data, or the bytes of m_payload_view. */
+    Span<const unsigned char> Payload() const { return m_payload_owner ? m_payload_view : Span{data}; }
+
+    /** Release the payload once it is no longer needed. */
+    void ClearPayload() noexcept
+    {
+        ClearShrink(data);
+        m_payload_owner.reset();
+        m_payload_view = {};
+    }
+
     /** Compute total memory usage of this object (own memory + any dynamic memory). */
     size_t GetMemoryUsage() const noexcept;
 };
@@ -8,6 +8,11 @@
 
 #include <net.h>
 #include <serialize.h>
+#include <span.h>
+
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace NetMsg {
     template <typename... Args>
@@ -18,6 +23,25 @@ namespace NetMsg {
         VectorWriter{msg.data, 0, std::forward<Args>(args)...};
         return msg;
     }
+
+    /** Make a message from an already serialized payload, without copying it. */
+    inline CSerializedNetMsg MakeRaw(std::string msg_type, std::vector<unsigned char>&& payload)
+    {
+        CSerializedNetMsg msg;
+        msg.m_type = std::move(msg_type);
+        msg.data = std::move(payload);
+        return msg;
+    }
+
+    /** Make a message whose payload is a view of bytes that owner keeps alive. */
+    inline CSerializedNetMsg MakeView(std::string msg_type, std::shared_ptr<const void> owner, Span<const unsigned char> payload)
+    {
+        CSerializedNetMsg msg;
+        msg.m_type = std::move(msg_type);
+        msg.m_payload_owner = std::move(owner);
+        msg.m_payload_view = payload;
+        return msg;
+    }
 } // namespace NetMsg
 
 #endif // BITCOIN_NETMESSAGEMAKER_H
@@ -17,6 +17,9 @@ namespace node {
 util::Result<void> ApplyArgsManOptions(const ArgsManager& args, BlockManager::Options& opts)
 {
     if (auto value{args.GetBoolArg("-blocksxor")}) opts.use_xor = *value;
+    if (auto value{args.GetBoolArg("-blocksmmap")}) opts.use_mmap = *value;
+    if (auto value{args.GetBoolArg("-blockindexsnapshot")}) opts.use_index_snapshot = *value;
+    if (auto value{args.GetIntArg("-reindexthreads")}) opts.reindex_threads = *value;
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg{args.GetIntArg("-prune", opts.prune_target)};
     if (nPruneArg < 0) {
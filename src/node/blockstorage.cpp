@@ -16,6 +16,7 @@
 #include <kernel/messagestartchars.h>
 #include <kernel/notifications_interface.h>
 #include <logging.h>
+#include <memusage.h>
 #include <pow.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
@@ -31,21 +32,36 @@
 #include <util/batchpriority.h>
 #include <util/check.h>
 #include <util/fs.h>
+#include <util/fs_helpers.h>
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
+#include <util/threadnames.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <map>
+#include <numeric>
 #include <ranges>
+#include <thread>
 #include <unordered_map>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace kernel {
 static constexpr uint8_t DB_BLOCK_FILES{'f'};
 static constexpr uint8_t DB_BLOCK_INDEX{'b'};
 static constexpr uint8_t DB_FLAG{'F'};
 static constexpr uint8_t DB_REINDEX_FLAG{'R'};
 static constexpr uint8_t DB_LAST_BLOCK{'l'};
+static constexpr uint8_t DB_INDEX_SNAPSHOT{'n'};
 // Keys used in previous version that might still be found in the DB:
 // BlockTreeDB::DB_TXINDEX_BLOCK{'T'};
 // BlockTreeDB::DB_TXINDEX{'t'}
@@ -85,6 +101,8 @@ bool BlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFi
     for (const CBlockIndex* bi : blockinfo) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, bi->GetBlockHash()), CDiskBlockIndex{bi});
     }
+    // Any block index snapshot file no longer matches the database.
+    batch.Erase(DB_INDEX_SNAPSHOT);
     return WriteBatch(batch, true);
 }
 
@@ -93,6 +111,21 @@ bool BlockTreeDB::WriteFlag(const std::string& name, bool fValue)
     return Write(std::make_pair(DB_FLAG, name), fValue ? uint8_t{'1'} : uint8_t{'0'});
 }
 
+bool BlockTreeDB::WriteIndexSnapshotNonce(uint64_t nonce)
+{
+    return Write(DB_INDEX_SNAPSHOT, nonce, /*fSync=*/true);
+}
+
+bool BlockTreeDB::ReadIndexSnapshotNonce(uint64_t& nonce)
+{
+    return Read(DB_INDEX_SNAPSHOT, nonce);
+}
+
+bool BlockTreeDB::EraseIndexSnapshotNonce()
+{
+    return Erase(DB_INDEX_SNAPSHOT, /*fSync=*/true);
+}
+
 bool BlockTreeDB::ReadFlag(const std::string& name, bool& fValue)
 {
     uint8_t ch;
@@ -103,55 +136,223 @@ bool BlockTreeDB::ReadFlag(const std::string& name, bool& fValue)
     return true;
 }
 
+namespace {
+/** A block index entry read from the database, along with its block hash. */
+struct LoadedBlockIndex {
+    uint256 hash;
+    CDiskBlockIndex diskindex;
+};
+
+/** The block index entries with keys in one range, once they have been read. */
+struct BlockIndexRange {
+    std::vector<LoadedBlockIndex> entries;
+    bool done{false};
+    bool ok{true};
+};
+
+/** State shared between the threads loading the block index. */
+struct BlockIndexLoadState {
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<BlockIndexRange> m_ranges GUARDED_BY(m_mutex);
+    //! The next range for a worker to read.
+    int m_next_range GUARDED_BY(m_mutex){0};
+    //! The next range to be inserted into the block index.
+    int m_next_to_insert GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+};
+} // namespace
+
 bool BlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, const util::SignalInterrupt& interrupt)
 {
     AssertLockHeld(::cs_main);
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load m_block_index
-    while (pcursor->Valid()) {
-        if (interrupt) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.ConstructBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams)) {
-                    LogError("%s: CheckProofOfWork failed: %s\n", __func__, pindexNew->ToString());
-                    return false;
-                }
+    // Block index entries are keyed by block hash, so they are spread evenly
+    // over the key space. Split it into ranges by the first byte of the hash,
+    // which worker threads read, deserialize and check the proof of work of in
+    // parallel. The ranges are inserted into the block index in key order on
+    // this thread. Workers only run a few ranges ahead of the insertion, which
+    // bounds the memory used by entries waiting to be inserted.
+    constexpr int NUM_RANGES{256};
+    const int num_threads{std::clamp<int>(std::thread::hardware_concurrency(), 1, MAX_BLOCK_INDEX_LOAD_THREADS)};
+    const int max_ranges_ahead{2 * num_threads};
+
+    BlockIndexLoadState state;
+    WITH_LOCK(state.m_mutex, state.m_ranges.resize(NUM_RANGES));
+
+    const auto read_ranges{[&] {
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        while (true) {
+            int range;
+            {
+                WAIT_LOCK(state.m_mutex, lock);
+                state.m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(state.m_mutex) {
+                    return state.m_stop || state.m_next_range < state.m_next_to_insert + max_ranges_ahead;
+                });
+                if (state.m_stop || state.m_next_range == NUM_RANGES) return;
+                range = state.m_next_range++;
+            }
 
+            std::vector<LoadedBlockIndex> entries;
+            bool ok{true};
+            uint256 range_start;
+            *range_start.begin() = range;
+            pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, range_start));
+            while (pcursor->Valid()) {
+                if (interrupt) {
+                    ok = false;
+                    break;
+                }
+                std::pair<uint8_t, uint256> key;
+                if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() != range) break;
+                LoadedBlockIndex& entry{entries.emplace_back()};
+                if (!pcursor->GetValue(entry.diskindex)) {
+                    LogError("%s: failed to read value\n", __func__);
+                    ok = false;
+                    break;
+                }
+                entry.hash = entry.diskindex.ConstructBlockHash();
+                if (!CheckProofOfWork(entry.hash, entry.diskindex.nBits, consensusParams)) {
+                    LogError("%s: CheckProofOfWork failed: height=%d, hash=%s\n", __func__, entry.diskindex.nHeight, entry.hash.ToString());
+                    ok = false;
+                    break;
+                }
                 pcursor->Next();
-            } else {
-                LogError("%s: failed to read value\n", __func__);
-                return false;
             }
-        } else {
-            break;
+
+            {
+                LOCK(state.m_mutex);
+                state.m_ranges[range].entries = std::move(entries);
+                state.m_ranges[range].ok = ok;
+                state.m_ranges[range].done = true;
+            }
+            state.m_cv.notify_all();
         }
+    }};
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (int n = 0; n < num_threads; ++n) {
+        workers.emplace_back([&read_ranges, n]() {
+            util::ThreadRename(strprintf("blkidx.%i", n));
+            read_ranges();
+        });
     }
 
-    return true;
+    // Load m_block_index
+    bool ok{true};
+    for (int range = 0; range < NUM_RANGES; ++range) {
+        std::vector<LoadedBlockIndex> entries;
+        {
+            WAIT_LOCK(state.m_mutex, lock);
+            state.m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(state.m_mutex) { return state.m_ranges[range].done; });
+            ok = state.m_ranges[range].ok;
+            entries = std::move(state.m_ranges[range].entries);
+            state.m_next_to_insert = range + 1;
+        }
+        state.m_cv.notify_all();
+        if (!ok) break;
+        for (const LoadedBlockIndex& entry : entries) {
+            const CDiskBlockIndex& diskindex{entry.diskindex};
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+        }
+    }
+
+    {
+        LOCK(state.m_mutex);
+        state.m_stop = true;
+    }
+    state.m_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    return ok;
 }
 } // namespace kernel
 
 namespace node {
 
+/** A block file mapped read-only into memory, unmapped on destruction. */
+class MappedBlockFile
+{
+private:
+    const std::byte* m_data;
+    size_t m_size;
+
+    MappedBlockFile(const std::byte* data, size_t size) : m_data{data}, m_size{size} {}
+
+public:
+    MappedBlockFile(const MappedBlockFile&) = delete;
+    MappedBlockFile& operator=(const MappedBlockFile&) = delete;
+
+    /** Map the file at path, or return nullptr if that is not possible on this platform or fails. */
+    static std::shared_ptr<const MappedBlockFile> Open(const fs::path& path)
+    {
+#ifndef WIN32
+        // Keeping all block files mapped needs a 64-bit address space.
+        if constexpr (sizeof(void*) < 8) return nullptr;
+        const int fd{open(fs::PathToString(path).c_str(), O_RDONLY)};
+        if (fd == -1) return nullptr;
+        struct stat st;
+        void* data{MAP_FAILED};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+        if (data == MAP_FAILED) return nullptr;
+        return std::shared_ptr<const MappedBlockFile>{new MappedBlockFile{static_cast<const std::byte*>(data), static_cast<size_t>(st.st_size)}};
+#else
+        return nullptr;
+#endif
+    }
+
+    ~MappedBlockFile()
+    {
+#ifndef WIN32
+        munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+    }
+
+    std::span<const std::byte> data() const { return {m_data, m_size}; }
+
+    /**
+     * Read the pages of range, which must be within data(), into memory on
+     * the calling thread, so that whoever reads the range next does not wait
+     * for the disk.
+     */
+    static void FaultIn(std::span<const std::byte> range)
+    {
+#ifndef WIN32
+        if (range.empty()) return;
+        const uintptr_t page_size{static_cast<uintptr_t>(sysconf(_SC_PAGESIZE))};
+        const uintptr_t begin{reinterpret_cast<uintptr_t>(range.data()) & ~(page_size - 1)};
+        const uintptr_t end{reinterpret_cast<uintptr_t>(range.data()) + range.size()};
+        // Ask for the whole range to be read ahead, then touch every page to
+        // wait for it.
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+        for (uintptr_t page = begin; page < end; page += page_size) {
+            const uintptr_t addr{std::max(page, reinterpret_cast<uintptr_t>(range.data()))};
+            (void)*reinterpret_cast<const volatile std::byte*>(addr);
+        }
+#endif
+    }
+};
+
 bool CBlockIndexWorkComparator::operator()(const CBlockIndex* pa, const CBlockIndex* pb) const
 {
     // First sort by most total work, ...
@@ -187,6 +388,35 @@ std::vector<CBlockIndex*> BlockManager::GetAllBlockIndices()
     return rv;
 }
 
+std::vector<CBlockIndex*> BlockManager::GetAllBlockIndicesByHeight()
+{
+    AssertLockHeld(cs_main);
+    // A contiguous block index has every height below the number of entries,
+    // so a counting sort orders it in two passes. Anything else is corrupt,
+    // and only needs sorting for the caller to report it.
+    int max_height{-1};
+    for (const auto& [_, block_index] : m_block_index) {
+        if (block_index.nHeight < 0 || size_t(block_index.nHeight) >= m_block_index.size()) {
+            std::vector<CBlockIndex*> rv{GetAllBlockIndices()};
+            std::sort(rv.begin(), rv.end(), CBlockIndexHeightOnlyComparator());
+            return rv;
+        }
+        max_height = std::max(max_height, block_index.nHeight);
+    }
+
+    // offsets[h] is where the entries at height h start.
+    std::vector<size_t> offsets(max_height + 2, 0);
+    for (const auto& [_, block_index] : m_block_index) {
+        ++offsets[block_index.nHeight + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<CBlockIndex*> rv(m_block_index.size());
+    for (auto& [_, block_index] : m_block_index) {
+        rv[offsets[block_index.nHeight]++] = &block_index;
+    }
+    return rv;
+}
+
 CBlockIndex* BlockManager::LookupBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -396,9 +626,17 @@ CBlockIndex* BlockManager::InsertBlockIndex(const uint256& hash)
 
 bool BlockManager::LoadBlockIndex(const std::optional<uint256>& snapshot_blockhash)
 {
-    if (!m_block_tree_db->LoadBlockIndexGuts(
-            GetConsensus(), [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }, m_interrupt)) {
-        return false;
+    const auto read_start{SteadyClock::now()};
+    if (m_opts.use_index_snapshot && m_block_index.empty() && LoadBlockIndexSnapshot()) {
+        LogPrintf("%s: read %u block index entries from the snapshot file in %.2fms\n", __func__,
+                  m_block_index.size(), Ticks<MillisecondsDouble>(SteadyClock::now() - read_start));
+    } else {
+        if (!m_block_tree_db->LoadBlockIndexGuts(
+                GetConsensus(), [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }, m_interrupt)) {
+            return false;
+        }
+        LogPrintf("%s: read %u block index entries from the database in %.2fms\n", __func__,
+                  m_block_index.size(), Ticks<MillisecondsDouble>(SteadyClock::now() - read_start));
     }
 
     if (snapshot_blockhash) {
@@ -426,9 +664,8 @@ bool BlockManager::LoadBlockIndex(const std::optional<uint256>& snapshot_blockha
     Assert(m_snapshot_height.has_value() == snapshot_blockhash.has_value());
 
     // Calculate nChainWork
-    std::vector<CBlockIndex*> vSortedByHeight{GetAllBlockIndices()};
-    std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
-              CBlockIndexHeightOnlyComparator());
+    const auto chain_work_start{SteadyClock::now()};
+    std::vector<CBlockIndex*> vSortedByHeight{GetAllBlockIndicesByHeight()};
 
     CBlockIndex* previous_index{nullptr};
     for (CBlockIndex* pindex : vSortedByHeight) {
@@ -469,10 +706,205 @@ bool BlockManager::LoadBlockIndex(const std::optional<uint256>& snapshot_blockha
             pindex->BuildSkip();
         }
     }
+    LogPrintf("%s: computed chain work of %u block index entries in %.2fms\n", __func__,
+              vSortedByHeight.size(), Ticks<MillisecondsDouble>(SteadyClock::now() - chain_work_start));
+
+    return true;
+}
+
+namespace {
+constexpr std::array<uint8_t, 5> INDEX_SNAPSHOT_MAGIC_BYTES{'b', 'i', 'd', 'x', 0xff};
+constexpr uint16_t INDEX_SNAPSHOT_VERSION{2};
+//! Position of the previous entry for entries without one.
+constexpr uint32_t INDEX_SNAPSHOT_NO_PREV{std::numeric_limits<uint32_t>::max()};
+//! Number of headers hashed at once to check the proof of work of the entries.
+constexpr size_t INDEX_SNAPSHOT_HASH_BATCH{2000};
+
+bool SameBlockFileInfo(const CBlockFileInfo& a, const CBlockFileInfo& b)
+{
+    return a.nBlocks == b.nBlocks && a.nSize == b.nSize && a.nUndoSize == b.nUndoSize &&
+           a.nHeightFirst == b.nHeightFirst && a.nHeightLast == b.nHeightLast &&
+           a.nTimeFirst == b.nTimeFirst && a.nTimeLast == b.nTimeLast;
+}
+} // namespace
+
+// The snapshot file consists of a header (magic bytes, version, the nonce that
+// is also stored in the block tree database, the last block file number and
+// its info, the best blocks of the coins databases, and the number of entries),
+// followed by one fixed size record per block index entry in height order, and
+// the hash of everything before it. Records refer to their previous entry by
+// its position in the file, which always comes earlier, so loading the block
+// index from the snapshot needs no hash lookups to link it.
+bool BlockManager::WriteBlockIndexSnapshot(const std::vector<uint256>& coins_tips)
+{
+    AssertLockHeld(::cs_main);
+    if (!m_opts.use_index_snapshot || !m_block_index_loaded) return false;
+    if (!m_dirty_blockindex.empty() || !m_dirty_fileinfo.empty()) return false;
+
+    const auto start{SteadyClock::now()};
+    const std::vector<CBlockIndex*> by_height{GetAllBlockIndicesByHeight()};
+    std::unordered_map<const CBlockIndex*, uint32_t> positions;
+    positions.reserve(by_height.size());
+    for (const CBlockIndex* pindex : by_height) {
+        positions.emplace(pindex, positions.size());
+    }
+
+    const fs::path path{GetBlockIndexSnapshotPath()};
+    fs::path temp_path{path};
+    temp_path += ".new";
+    const uint64_t nonce{FastRandomContext{}.rand64()};
+    try {
+        AutoFile file{fsbridge::fopen(temp_path, "wb")};
+        if (file.IsNull()) {
+            LogError("%s: failed to open %s\n", __func__, fs::PathToString(temp_path));
+            return false;
+        }
+        HashedSourceWriter writer{file};
+        const int last_file{WITH_LOCK(cs_LastBlockFile, return MaxBlockfileNum())};
+        writer << INDEX_SNAPSHOT_MAGIC_BYTES << INDEX_SNAPSHOT_VERSION << nonce
+               << last_file << m_blockfile_info.at(last_file) << coins_tips << uint64_t(by_height.size());
+        for (uint32_t pos = 0; pos < by_height.size(); ++pos) {
+            const CBlockIndex* pindex{by_height[pos]};
+            uint32_t prev{INDEX_SNAPSHOT_NO_PREV};
+            if (pindex->pprev) {
+                const auto it{positions.find(pindex->pprev)};
+                if (it == positions.end() || it->second >= pos) {
+                    throw std::ios_base::failure{strprintf("block index entry %s is not linked to an earlier entry", pindex->GetBlockHash().ToString())};
+                }
+                prev = it->second;
+            }
+            writer << pindex->GetBlockHash() << prev << pindex->nHeight << pindex->nStatus << pindex->nTx
+                   << pindex->nFile << pindex->nDataPos << pindex->nUndoPos
+                   << pindex->nVersion << pindex->hashMerkleRoot << pindex->nTime << pindex->nBits << pindex->nNonce;
+        }
+        file << writer.GetHash();
+        if (!file.Commit() || file.fclose() != 0) {
+            throw std::ios_base::failure{"failed to commit"};
+        }
+    } catch (const std::exception& e) {
+        LogError("%s: failed to write %s: %s\n", __func__, fs::PathToString(temp_path), e.what());
+        std::error_code ec;
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    if (!RenameOver(temp_path, path)) {
+        LogError("%s: failed to rename %s\n", __func__, fs::PathToString(temp_path));
+        std::error_code ec;
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    if (!m_block_tree_db->WriteIndexSnapshotNonce(nonce)) {
+        return false;
+    }
+    LogPrintf("Wrote %u block index entries to the block index snapshot in %.2fms\n",
+              by_height.size(), Ticks<MillisecondsDouble>(SteadyClock::now() - start));
+    return true;
+}
+
+bool BlockManager::LoadBlockIndexSnapshot()
+{
+    AssertLockHeld(cs_main);
+    uint64_t nonce;
+    if (!m_block_tree_db->ReadIndexSnapshotNonce(nonce)) return false;
+
+    const auto mapped{MappedBlockFile::Open(GetBlockIndexSnapshotPath())};
+    if (!mapped) {
+        LogPrintf("Could not map the block index snapshot file, loading the block index from the database\n");
+        return false;
+    }
+    const std::span<const std::byte> data{mapped->data()};
+    if (data.size() < uint256::size() ||
+        Hash(data.first(data.size() - uint256::size())) != uint256{MakeUCharSpan(data.last(uint256::size()))}) {
+        LogPrintf("The block index snapshot file is corrupt, loading the block index from the database\n");
+        return false;
+    }
+
+    try {
+        SpanReader reader{MakeUCharSpan(data.first(data.size() - uint256::size()))};
+        std::array<uint8_t, INDEX_SNAPSHOT_MAGIC_BYTES.size()> magic;
+        uint16_t version;
+        uint64_t file_nonce, count;
+        reader >> magic >> version;
+        if (magic != INDEX_SNAPSHOT_MAGIC_BYTES || version != INDEX_SNAPSHOT_VERSION) {
+            throw std::ios_base::failure{"unknown format"};
+        }
+        int last_file;
+        CBlockFileInfo last_file_info;
+        std::vector<uint256> coins_tips;
+        reader >> file_nonce >> last_file >> last_file_info >> coins_tips >> count;
+        if (file_nonce != nonce) {
+            throw std::ios_base::failure{"nonce mismatch"};
+        }
+        // Software that does not know about the snapshot leaves the nonce in
+        // place when it writes to the database, but it would have updated the
+        // block file info along with any new block.
+        int db_last_file;
+        CBlockFileInfo db_last_file_info;
+        if (!m_block_tree_db->ReadLastBlockFile(db_last_file) || db_last_file != last_file ||
+            !m_block_tree_db->ReadBlockFileInfo(db_last_file, db_last_file_info) || !SameBlockFileInfo(db_last_file_info, last_file_info)) {
+            throw std::ios_base::failure{"block file info mismatch"};
+        }
 
+        std::vector<CBlockIndex*> entries;
+        entries.reserve(count);
+        m_block_index.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            uint256 hash;
+            uint32_t prev;
+            reader >> hash >> prev;
+            if (prev != INDEX_SNAPSHOT_NO_PREV && prev >= i) {
+                throw std::ios_base::failure{"entry not linked to an earlier entry"};
+            }
+            CBlockIndex* pindex{InsertBlockIndex(hash)};
+            if (!pindex) throw std::ios_base::failure{"null block hash"};
+            pindex->pprev = prev == INDEX_SNAPSHOT_NO_PREV ? nullptr : entries[prev];
+            reader >> pindex->nHeight >> pindex->nStatus >> pindex->nTx
+                   >> pindex->nFile >> pindex->nDataPos >> pindex->nUndoPos
+                   >> pindex->nVersion >> pindex->hashMerkleRoot >> pindex->nTime >> pindex->nBits >> pindex->nNonce;
+            entries.push_back(pindex);
+        }
+        if (!reader.empty() || m_block_index.size() != count) {
+            throw std::ios_base::failure{"unexpected number of entries"};
+        }
+
+        // Check the hashes and proof of work of the entries, as
+        // LoadBlockIndexGuts() does.
+        std::vector<CBlockHeader> headers;
+        headers.reserve(INDEX_SNAPSHOT_HASH_BATCH);
+        for (size_t begin = 0; begin < entries.size(); begin += INDEX_SNAPSHOT_HASH_BATCH) {
+            if (m_interrupt) throw std::ios_base::failure{"interrupted"};
+            const auto batch{std::span{entries}.subspan(begin, std::min(INDEX_SNAPSHOT_HASH_BATCH, entries.size() - begin))};
+            headers.clear();
+            for (const CBlockIndex* pindex : batch) headers.push_back(pindex->GetBlockHeader());
+            const std::vector<uint256> hashes{GetBlockHeaderHashes(headers)};
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (hashes[i] != batch[i]->GetBlockHash() || !CheckProofOfWork(hashes[i], batch[i]->nBits, GetConsensus())) {
+                    throw std::ios_base::failure{strprintf("invalid header at height %d", batch[i]->nHeight)};
+                }
+            }
+        }
+        m_index_snapshot_coins_tips = std::move(coins_tips);
+    } catch (const std::exception& e) {
+        LogPrintf("Could not load the block index snapshot file (%s), loading the block index from the database\n", e.what());
+        m_block_index.clear();
+        return false;
+    }
     return true;
 }
 
+bool BlockManager::CheckIndexSnapshotCoinsTip(const uint256& coins_tip)
+{
+    AssertLockHeld(cs_main);
+    if (!m_index_snapshot_coins_tips || std::ranges::find(*m_index_snapshot_coins_tips, coins_tip) != m_index_snapshot_coins_tips->end()) {
+        return true;
+    }
+    LogPrintf("The coins database is at block %s, which the block index snapshot was not written with. Discarding the snapshot.\n", coins_tip.ToString());
+    m_block_tree_db->EraseIndexSnapshotNonce();
+    m_index_snapshot_coins_tips.reset();
+    m_index_snapshot_rejected = true;
+    return false;
+}
+
 bool BlockManager::WriteBlockIndexDB()
 {
     AssertLockHeld(::cs_main);
@@ -497,9 +929,13 @@ bool BlockManager::WriteBlockIndexDB()
 
 bool BlockManager::LoadBlockIndexDB(const std::optional<uint256>& snapshot_blockhash)
 {
+    const auto load_start{SteadyClock::now()};
     if (!LoadBlockIndex(snapshot_blockhash)) {
         return false;
     }
+    LogPrintf("%s: loaded %u block index entries in %.2fms, using %.1f MiB\n", __func__,
+              m_block_index.size(), Ticks<MillisecondsDouble>(SteadyClock::now() - load_start),
+              memusage::DynamicUsage(m_block_index) * (1.0 / (1 << 20)));
     int max_blockfile_num{0};
 
     // Load block file info
@@ -554,6 +990,7 @@ bool BlockManager::LoadBlockIndexDB(const std::optional<uint256>& snapshot_block
     m_block_tree_db->ReadReindexing(fReindexing);
     if (fReindexing) m_blockfiles_indexed = false;
 
+    m_block_index_loaded = true;
     return true;
 }
 
@@ -682,15 +1119,16 @@ bool BlockManager::UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos
     unsigned int nSize = GetSerializeSize(blockundo);
     fileout << GetParams().MessageStart() << nSize;
 
-    // Write undo data
+    // Write undo data, hashing it for the checksum on the way so that it is
+    // serialized only once. The checksum also commits to the block hash,
+    // which is hashed but not written.
     long fileOutPos = fileout.tell();
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
-
-    // calculate & write checksum
-    HashWriter hasher{};
-    hasher << hashBlock;
+    HashedSourceWriter hasher{fileout};
+    static_cast<HashWriter&>(hasher) << hashBlock;
     hasher << blockundo;
+
+    // write checksum
     fileout << hasher.GetHash();
 
     return true;
@@ -728,6 +1166,70 @@ bool BlockManager::UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& in
     return true;
 }
 
+std::unique_ptr<BlockUndoCursor> BlockManager::OpenUndoCursor(const CBlockIndex& index) const
+{
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return index.GetUndoPos())};
+
+    std::FILE* file{m_undo_file_seq.Open(pos, /*read_only=*/true)};
+    if (!file) {
+        LogError("%s: OpenUndoFile failed for %s\n", __func__, pos.ToString());
+        return nullptr;
+    }
+    auto cursor{std::make_unique<BlockUndoCursor>(file, m_xor_key, pos)};
+    if (!cursor->Verify(index.pprev->GetBlockHash())) {
+        return nullptr;
+    }
+    return cursor;
+}
+
+BlockUndoCursor::BlockUndoCursor(std::FILE* file, std::vector<std::byte> data_xor, const FlatFilePos& pos)
+    : m_file{file, std::move(data_xor)}, m_pos{pos} {}
+
+bool BlockUndoCursor::Verify(const uint256& prev_block_hash)
+{
+    m_tx_positions.clear();
+
+    // Deserialize the vtxundo vector of the CBlockUndo element by element,
+    // reusing a single CTxUndo, to find where each of them starts.
+    uint256 hashChecksum;
+    HashVerifier verifier{m_file};
+    try {
+        verifier << prev_block_hash;
+        const uint64_t num_txs{ReadCompactSize(verifier)};
+        CTxUndo txundo;
+        for (uint64_t i = 0; i < num_txs; ++i) {
+            m_tx_positions.push_back(m_file.tell());
+            verifier >> txundo;
+        }
+        m_file >> hashChecksum;
+    } catch (const std::exception& e) {
+        LogError("%s: Deserialize or I/O error - %s at %s\n", __func__, e.what(), m_pos.ToString());
+        m_tx_positions.clear();
+        return false;
+    }
+
+    if (hashChecksum != verifier.GetHash()) {
+        LogError("%s: Checksum mismatch at %s\n", __func__, m_pos.ToString());
+        m_tx_positions.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool BlockUndoCursor::ReadTxUndo(size_t i, CTxUndo& txundo)
+{
+    try {
+        const int64_t tx_pos{m_tx_positions.at(i)};
+        if (m_file.tell() != tx_pos) m_file.seek(tx_pos, SEEK_SET);
+        m_file >> txundo;
+    } catch (const std::exception& e) {
+        LogError("%s: Deserialize or I/O error - %s at %s\n", __func__, e.what(), m_pos.ToString());
+        return false;
+    }
+    return true;
+}
+
 bool BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
@@ -805,6 +1307,7 @@ void BlockManager::UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const
     std::error_code ec;
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        WITH_LOCK(m_mapped_files_mutex, m_mapped_files.erase(*it));
         const bool removed_blockfile{fs::remove(m_block_file_seq.FileName(pos), ec)};
         const bool removed_undofile{fs::remove(m_undo_file_seq.FileName(pos), ec)};
         if (removed_blockfile || removed_undofile) {
@@ -818,6 +1321,60 @@ AutoFile BlockManager::OpenBlockFile(const FlatFilePos& pos, bool fReadOnly) con
     return AutoFile{m_block_file_seq.Open(pos, fReadOnly), m_xor_key};
 }
 
+static bool IsObfuscated(std::span<const std::byte> xor_key)
+{
+    return std::ranges::any_of(xor_key, [](std::byte b) { return b != std::byte{0}; });
+}
+
+std::shared_ptr<const MappedBlockFile> BlockManager::GetMappedBlockFile(int file_num) const
+{
+    if (!m_opts.use_mmap) return nullptr;
+    {
+        // Files at or after a write cursor may still grow, or be truncated
+        // when they are finalized, which must not happen under a mapping.
+        LOCK(cs_LastBlockFile);
+        for (const auto& cursor : m_blockfile_cursors) {
+            if (cursor && file_num >= cursor->file_num) return nullptr;
+        }
+    }
+    LOCK(m_mapped_files_mutex);
+    auto it{m_mapped_files.find(file_num)};
+    if (it == m_mapped_files.end()) {
+        auto mapped{MappedBlockFile::Open(m_block_file_seq.FileName(FlatFilePos{file_num, 0}))};
+        if (!mapped) return nullptr;
+        LogDebug(BCLog::BLOCKSTORAGE, "Mapped block file %05u (%u bytes)\n", file_num, mapped->data().size());
+        it = m_mapped_files.emplace(file_num, std::move(mapped)).first;
+    }
+    return it->second;
+}
+
+std::optional<std::span<const std::byte>> BlockManager::GetMappedBlock(const MappedBlockFile& file, const FlatFilePos& pos) const
+{
+    const auto data{file.data()};
+    // If nPos is less than 8 the pos is null and we don't have the block data
+    if (pos.nPos < BLOCK_SERIALIZATION_HEADER_SIZE || pos.nPos > data.size()) {
+        LogError("%s: Invalid position %s in mapped block file\n", __func__, pos.ToString());
+        return std::nullopt;
+    }
+    std::array<std::byte, BLOCK_SERIALIZATION_HEADER_SIZE> header;
+    std::copy_n(data.begin() + pos.nPos - header.size(), header.size(), header.begin());
+    util::Xor(header, m_xor_key, pos.nPos - header.size());
+    MessageStartChars blk_start;
+    unsigned int blk_size;
+    SpanReader{MakeUCharSpan(header)} >> blk_start >> blk_size;
+    if (blk_start != GetParams().MessageStart()) {
+        LogError("%s: Block magic mismatch for %s: %s versus expected %s\n", __func__, pos.ToString(),
+                     HexStr(blk_start),
+                     HexStr(GetParams().MessageStart()));
+        return std::nullopt;
+    }
+    if (blk_size > MAX_SIZE || blk_size > data.size() - pos.nPos) {
+        LogError("%s: Block size %u out of range for %s\n", __func__, blk_size, pos.ToString());
+        return std::nullopt;
+    }
+    return data.subspan(pos.nPos, blk_size);
+}
+
 /** Open an undo file (rev?????.dat) */
 AutoFile BlockManager::OpenUndoFile(const FlatFilePos& pos, bool fReadOnly) const
 {
@@ -1030,19 +1587,37 @@ bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) cons
 {
     block.SetNull();
 
-    // Open history file to read
-    AutoFile filein{OpenBlockFile(pos, true)};
-    if (filein.IsNull()) {
-        LogError("%s: OpenBlockFile failed for %s\n", __func__, pos.ToString());
-        return false;
-    }
+    if (const auto mapped{GetMappedBlockFile(pos.nFile)}) {
+        const auto data{GetMappedBlock(*mapped, pos)};
+        if (!data) return false;
+        try {
+            if (!IsObfuscated(m_xor_key)) {
+                // Deserialize straight from the mapped file.
+                SpanReader{MakeUCharSpan(*data)} >> TX_WITH_WITNESS(block);
+            } else {
+                std::vector<std::byte> buffer{data->begin(), data->end()};
+                util::Xor(buffer, m_xor_key, pos.nPos);
+                SpanReader{MakeUCharSpan(buffer)} >> TX_WITH_WITNESS(block);
+            }
+        } catch (const std::exception& e) {
+            LogError("%s: Deserialize error - %s at %s\n", __func__, e.what(), pos.ToString());
+            return false;
+        }
+    } else {
+        // Open history file to read
+        AutoFile filein{OpenBlockFile(pos, true)};
+        if (filein.IsNull()) {
+            LogError("%s: OpenBlockFile failed for %s\n", __func__, pos.ToString());
+            return false;
+        }
 
-    // Read block
-    try {
-        filein >> TX_WITH_WITNESS(block);
-    } catch (const std::exception& e) {
-        LogError("%s: Deserialize or I/O error - %s at %s\n", __func__, e.what(), pos.ToString());
-        return false;
+        // Read block
+        try {
+            filein >> TX_WITH_WITNESS(block);
+        } catch (const std::exception& e) {
+            LogError("%s: Deserialize or I/O error - %s at %s\n", __func__, e.what(), pos.ToString());
+            return false;
+        }
     }
 
     // Check the header
@@ -1083,6 +1658,13 @@ bool BlockManager::ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatF
         LogError("%s: OpenBlockFile failed for %s\n", __func__, pos.ToString());
         return false;
     }
+    if (const auto mapped{GetMappedBlockFile(pos.nFile)}) {
+        const auto data{GetMappedBlock(*mapped, pos)};
+        if (!data) return false;
+        block.assign(UCharCast(data->data()), UCharCast(data->data() + data->size()));
+        util::Xor(MakeWritableByteSpan(block), m_xor_key, pos.nPos);
+        return true;
+    }
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     AutoFile filein{OpenBlockFile(hpos, true)};
     if (filein.IsNull()) {
@@ -1119,6 +1701,19 @@ bool BlockManager::ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatF
     return true;
 }
 
+std::optional<std::pair<std::shared_ptr<const void>, std::span<const std::byte>>> BlockManager::GetRawBlockView(const FlatFilePos& pos) const
+{
+    if (IsObfuscated(m_xor_key)) return std::nullopt;
+    auto mapped{GetMappedBlockFile(pos.nFile)};
+    if (!mapped) return std::nullopt;
+    const auto data{GetMappedBlock(*mapped, pos)};
+    if (!data) return std::nullopt;
+    // The view is sent from the socket handler thread, which serves all
+    // peers, so do the disk reads here instead of on its page faults.
+    MappedBlockFile::FaultIn(*data);
+    return std::make_pair(std::shared_ptr<const void>{std::move(mapped)}, *data);
+}
+
 FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight)
 {
     unsigned int nBlockSize = ::GetSerializeSize(TX_WITH_WITNESS(block));
@@ -1202,6 +1797,122 @@ public:
     }
 };
 
+namespace {
+/** The blocks of one block file, once a worker thread has read them during a parallel -reindex. */
+struct ReindexBlockFile {
+    std::vector<ExternalBlock> blocks;
+    bool done{false};
+    //! False if there is no block file with this number, which ends the reindex.
+    bool exists{true};
+    std::optional<std::string> error;
+};
+
+/** State shared between the threads of a parallel -reindex. */
+struct ReindexState {
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::map<int, ReindexBlockFile> m_files GUARDED_BY(m_mutex);
+    //! The next block file for a worker to read.
+    int m_next_file GUARDED_BY(m_mutex){0};
+    //! The next block file to have its blocks accepted.
+    int m_next_to_load GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+};
+} // namespace
+
+/**
+ * Reindex the block files, with worker threads locating, deserializing and
+ * checking the blocks of the next few block files, while this thread accepts
+ * them in file order. Blocks whose parent is not known yet are tracked in
+ * blocks_with_unknown_parent, and accepted once the parent is, as for a
+ * reindex that reads one block file at a time. Workers only run one file
+ * each ahead of the file being accepted, which bounds the memory used by
+ * blocks waiting to be accepted.
+ */
+static void ReindexBlockFilesParallel(ChainstateManager& chainman, int num_threads, std::multimap<uint256, FlatFilePos>& blocks_with_unknown_parent)
+{
+    BlockManager& blockman{chainman.m_blockman};
+    const int max_files_ahead{num_threads};
+
+    ReindexState state;
+
+    const auto read_files{[&] {
+        while (true) {
+            int file_num;
+            {
+                WAIT_LOCK(state.m_mutex, lock);
+                state.m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(state.m_mutex) {
+                    return state.m_stop || state.m_next_file < state.m_next_to_load + max_files_ahead;
+                });
+                if (state.m_stop) return;
+                file_num = state.m_next_file++;
+            }
+
+            ReindexBlockFile result;
+            const FlatFilePos pos(file_num, 0);
+            if (!fs::exists(blockman.GetBlockPosFilename(pos))) {
+                result.exists = false; // No block files left to reindex
+            } else if (AutoFile file{blockman.OpenBlockFile(pos, true)}; file.IsNull()) {
+                result.exists = false; // This error is logged in OpenBlockFile
+            } else {
+                try {
+                    result.blocks = ReadExternalBlockFile(file, file_num, chainman.GetParams(), chainman.m_interrupt);
+                } catch (const std::runtime_error& e) {
+                    result.error = e.what();
+                }
+            }
+
+            {
+                LOCK(state.m_mutex);
+                ReindexBlockFile& slot{state.m_files[file_num]};
+                slot = std::move(result);
+                slot.done = true;
+            }
+            state.m_cv.notify_all();
+        }
+    }};
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (int n = 0; n < num_threads; ++n) {
+        workers.emplace_back([&read_files, n]() {
+            util::ThreadRename(strprintf("reindex.%i", n));
+            read_files();
+        });
+    }
+    LogPrintf("Reindexing block files with %d threads reading ahead\n", num_threads);
+
+    for (int file_num = 0;; ++file_num) {
+        ReindexBlockFile file;
+        {
+            WAIT_LOCK(state.m_mutex, lock);
+            state.m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(state.m_mutex) { return state.m_files[file_num].done; });
+            file = std::move(state.m_files[file_num]);
+            state.m_files.erase(file_num);
+            state.m_next_to_load = file_num + 1;
+        }
+        state.m_cv.notify_all();
+        if (!file.exists) break;
+
+        LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)file_num);
+        if (file.error) {
+            chainman.GetNotifications().fatalError(strprintf(_("System error while loading external block file: %s"), *file.error));
+        } else {
+            chainman.LoadExternalBlocks(std::move(file.blocks), blocks_with_unknown_parent);
+        }
+        if (chainman.m_interrupt) break;
+    }
+
+    {
+        LOCK(state.m_mutex);
+        state.m_stop = true;
+    }
+    state.m_cv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
 void ImportBlocks(ChainstateManager& chainman, std::span<const fs::path> import_paths)
 {
     ImportingNow imp{chainman.m_blockman.m_importing};
@@ -1212,22 +1923,30 @@ void ImportBlocks(ChainstateManager& chainman, std::span<const fs::path> import_
         // Map of disk positions for blocks with unknown parent (only used for reindex);
         // parent hash -> child disk position, multiple children can have the same parent.
         std::multimap<uint256, FlatFilePos> blocks_with_unknown_parent;
-        while (true) {
-            FlatFilePos pos(nFile, 0);
-            if (!fs::exists(chainman.m_blockman.GetBlockPosFilename(pos))) {
-                break; // No block files left to reindex
-            }
-            AutoFile file{chainman.m_blockman.OpenBlockFile(pos, true)};
-            if (file.IsNull()) {
-                break; // This error is logged in OpenBlockFile
-            }
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            chainman.LoadExternalBlockFile(file, &pos, &blocks_with_unknown_parent);
+        if (const int num_threads{chainman.m_blockman.ReindexThreads()}; num_threads > 0) {
+            ReindexBlockFilesParallel(chainman, num_threads, blocks_with_unknown_parent);
             if (chainman.m_interrupt) {
                 LogPrintf("Interrupt requested. Exit %s\n", __func__);
                 return;
             }
-            nFile++;
+        } else {
+            while (true) {
+                FlatFilePos pos(nFile, 0);
+                if (!fs::exists(chainman.m_blockman.GetBlockPosFilename(pos))) {
+                    break; // No block files left to reindex
+                }
+                AutoFile file{chainman.m_blockman.OpenBlockFile(pos, true)};
+                if (file.IsNull()) {
+                    break; // This error is logged in OpenBlockFile
+                }
+                LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+                chainman.LoadExternalBlockFile(file, &pos, &blocks_with_unknown_parent);
+                if (chainman.m_interrupt) {
+                    LogPrintf("Interrupt requested. Exit %s\n", __func__);
+                    return;
+                }
+                nFile++;
+            }
         }
         WITH_LOCK(::cs_main, chainman.m_blockman.m_block_tree_db->WriteReindexing(false));
         chainman.m_blockman.m_blockfiles_indexed = true;
@@ -1266,6 +1985,128 @@ void ImportBlocks(ChainstateManager& chainman, std::span<const fs::path> import_
     // End scope of ImportingNow
 }
 
+bool WriteHeadersFile(const fs::path& path, const CChainParams& params, std::span<const CBlockHeader> headers)
+{
+    AutoFile file{fsbridge::fopen(path, "wb")};
+    if (file.IsNull()) {
+        LogError("%s: failed to open %s\n", __func__, fs::PathToString(path));
+        return false;
+    }
+    try {
+        file << params.MessageStart();
+        WriteCompactSize(file, headers.size());
+        for (const CBlockHeader& header : headers) {
+            file << header;
+        }
+    } catch (const std::exception& e) {
+        LogError("%s: failed to write %s - %s\n", __func__, fs::PathToString(path), e.what());
+        return false;
+    }
+    if (file.fclose() != 0) {
+        LogError("%s: failed to close %s\n", __func__, fs::PathToString(path));
+        return false;
+    }
+    return true;
+}
+
+bool ImportHeaders(ChainstateManager& chainman, const fs::path& path)
+{
+    const auto start{SteadyClock::now()};
+    const CChainParams& params{chainman.GetParams()};
+
+    std::vector<CBlockHeader> headers;
+    {
+        AutoFile file{fsbridge::fopen(path, "rb")};
+        if (file.IsNull()) {
+            LogError("Could not open headers file %s\n", fs::PathToString(path));
+            return false;
+        }
+        try {
+            MessageStartChars message_start;
+            file >> message_start;
+            if (message_start != params.MessageStart()) {
+                LogError("Headers file %s is for a different network\n", fs::PathToString(path));
+                return false;
+            }
+            const uint64_t num_headers{ReadCompactSize(file)};
+            for (uint64_t i = 0; i < num_headers; ++i) {
+                file >> headers.emplace_back();
+            }
+        } catch (const std::exception& e) {
+            LogError("Failed to read headers file %s: %s\n", fs::PathToString(path), e.what());
+            return false;
+        }
+    }
+    if (headers.empty()) return true;
+
+    // Hashing the headers and checking their proof of work is what takes time,
+    // so split it between threads.
+    constexpr size_t HEADERS_HASH_BATCH{2000};
+    std::vector<uint256> hashes(headers.size());
+    std::atomic<bool> pow_ok{true};
+    const int num_threads{std::clamp<int>(std::thread::hardware_concurrency(), 1, MAX_HEADERS_LOAD_THREADS)};
+    const size_t per_thread{(headers.size() + num_threads - 1) / num_threads};
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads);
+    for (int n = 0; n < num_threads; ++n) {
+        workers.emplace_back([&, n]() {
+            util::ThreadRename(strprintf("loadhdrs.%i", n));
+            const size_t end{std::min(headers.size(), (n + 1) * per_thread)};
+            // Hash a cache-sized batch at a time, several headers in parallel.
+            for (size_t begin = n * per_thread; begin < end && pow_ok; begin += HEADERS_HASH_BATCH) {
+                const auto batch{std::span{headers}.subspan(begin, std::min(HEADERS_HASH_BATCH, end - begin))};
+                const std::vector<uint256> batch_hashes{GetBlockHeaderHashes(batch)};
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    hashes[begin + i] = batch_hashes[i];
+                    if (!CheckProofOfWork(batch_hashes[i], batch[i].nBits, params.GetConsensus())) pow_ok = false;
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (!pow_ok) {
+        LogError("Headers file %s contains a header with invalid proof of work\n", fs::PathToString(path));
+        return false;
+    }
+    for (size_t i = 1; i < headers.size(); ++i) {
+        if (headers[i].hashPrevBlock != hashes[i - 1]) {
+            LogError("Headers in file %s do not form a chain\n", fs::PathToString(path));
+            return false;
+        }
+    }
+
+    // Enforce the same minimum chain work as the headers sync with peers does,
+    // before accepting any of the headers.
+    {
+        LOCK(cs_main);
+        const CBlockIndex* parent{chainman.m_blockman.LookupBlockIndex(headers.front().hashPrevBlock)};
+        if (!parent) {
+            LogError("Headers file %s does not connect to a known block\n", fs::PathToString(path));
+            return false;
+        }
+        if (parent->nChainWork + CalculateClaimedHeadersWork(headers) < chainman.MinimumChainWork()) {
+            LogError("Headers file %s does not reach the minimum chain work\n", fs::PathToString(path));
+            return false;
+        }
+    }
+
+    // Accept the headers in batches, so that progress is reported and an
+    // interrupt is noticed.
+    constexpr size_t BATCH_SIZE{2000};
+    for (size_t i = 0; i < headers.size(); i += BATCH_SIZE) {
+        if (chainman.m_interrupt) return false;
+        BlockValidationState state;
+        if (!chainman.ProcessNewBlockHeaders(std::span{headers}.subspan(i, std::min(BATCH_SIZE, headers.size() - i)), /*min_pow_checked=*/true, state)) {
+            LogError("Failed to load headers from %s: %s\n", fs::PathToString(path), state.ToString());
+            return false;
+        }
+    }
+    LogInfo("Loaded %u headers from %s in %dms\n", headers.size(), fs::PathToString(path), Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
+    return true;
+}
+
 std::ostream& operator<<(std::ostream& os, const BlockfileType& type) {
     switch(type) {
         case BlockfileType::NORMAL: os << "normal"; break;
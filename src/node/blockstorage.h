@@ -15,11 +15,13 @@
 #include <kernel/messagestartchars.h>
 #include <primitives/block.h>
 #include <streams.h>
+#include <support/allocators/pool.h>
 #include <sync.h>
 #include <uint256.h>
 #include <util/fs.h>
 #include <util/hasher.h>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cstdint>
@@ -37,6 +39,7 @@
 
 class BlockValidationState;
 class CBlockUndo;
+class CTxUndo;
 class Chainstate;
 class ChainstateManager;
 namespace Consensus {
@@ -47,6 +50,9 @@ class SignalInterrupt;
 } // namespace util
 
 namespace kernel {
+/** Maximum number of threads used to read the block index from the database. */
+static constexpr int MAX_BLOCK_INDEX_LOAD_THREADS{8};
+
 /** Access to the block database (blocks/index/) */
 class BlockTreeDB : public CDBWrapper
 {
@@ -59,6 +65,14 @@ public:
     void ReadReindexing(bool& fReindexing);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
+    bool WriteIndexSnapshotNonce(uint64_t nonce);
+    bool ReadIndexSnapshotNonce(uint64_t& nonce);
+    bool EraseIndexSnapshotNonce();
+    /**
+     * Read all block index entries from the database, using up to
+     * MAX_BLOCK_INDEX_LOAD_THREADS threads to deserialize them, and add them
+     * through insertBlockIndex in key order on the calling thread.
+     */
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, const util::SignalInterrupt& interrupt)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 };
@@ -73,6 +87,10 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
+/** Maximum number of threads reading block files ahead during -reindex. */
+static constexpr int MAX_REINDEX_THREADS{16};
+/** Maximum number of threads checking the proof of work of headers loaded from a file. */
+static constexpr int MAX_HEADERS_LOAD_THREADS{8};
 
 /** Size of header written by WriteBlockToDisk before a serialized CBlock */
 static constexpr size_t BLOCK_SERIALIZATION_HEADER_SIZE = std::tuple_size_v<MessageStartChars> + sizeof(unsigned int);
@@ -81,7 +99,23 @@ static constexpr size_t BLOCK_SERIALIZATION_HEADER_SIZE = std::tuple_size_v<Mess
 // we ever switch to another associative container, we need to either use a
 // container that has stable addressing (true of all std associative
 // containers), or make the key a `std::unique_ptr<CBlockIndex>`
-using BlockMap = std::unordered_map<uint256, CBlockIndex, BlockHasher>;
+//
+// The nodes are allocated from a PoolResource instead of one heap allocation
+// each, which packs the index entries into large contiguous chunks: this saves
+// the per-allocation malloc overhead and keeps entries that were loaded
+// together close in memory. The node size is estimated the same way as for
+// CCoinsMap. Node addresses are still stable, since the pool never moves
+// allocated memory.
+using BlockMap = std::unordered_map<uint256,
+                                    CBlockIndex,
+                                    BlockHasher,
+                                    std::equal_to<uint256>,
+                                    PoolAllocator<std::pair<const uint256, CBlockIndex>,
+                                                  sizeof(std::pair<const uint256, CBlockIndex>) + sizeof(void*) * 4>>;
+
+using BlockMapMemoryResource = BlockMap::allocator_type::ResourceType;
+
+class MappedBlockFile;
 
 struct CBlockIndexWorkComparator {
     bool operator()(const CBlockIndex* pa, const CBlockIndex* pb) const;
@@ -124,6 +158,43 @@ struct BlockfileCursor {
 
 std::ostream& operator<<(std::ostream& os, const BlockfileCursor& cursor);
 
+/**
+ * Cursor over the undo data of a single block in its rev?????.dat file, which
+ * hands out the undo data of one transaction at a time instead of a whole
+ * CBlockUndo.
+ *
+ * Opening it reads through the undo data once, hashing it as it goes, to
+ * verify the checksum and to note where the undo data of each transaction
+ * starts. Nothing is handed out before the checksum is verified, and the
+ * transactions can be read in any order afterwards (DisconnectBlock wants them
+ * in reverse), keeping at most one of them in memory.
+ */
+class BlockUndoCursor
+{
+private:
+    AutoFile m_file;
+    FlatFilePos m_pos;
+    //! File position of the undo data of every non-coinbase transaction
+    std::vector<int64_t> m_tx_positions;
+
+public:
+    //! Takes ownership of the file, which must be positioned at the start of the undo data.
+    BlockUndoCursor(std::FILE* file, std::vector<std::byte> data_xor, const FlatFilePos& pos);
+
+    /**
+     * Read through the undo data of the block with the given previous block
+     * hash and verify its checksum. Must be called, and succeed, before
+     * ReadTxUndo().
+     */
+    [[nodiscard]] bool Verify(const uint256& prev_block_hash);
+
+    //! Number of transactions with undo data, i.e. all but the coinbase.
+    size_t size() const { return m_tx_positions.size(); }
+
+    //! Read the undo data of the transaction at index i + 1 of the block.
+    [[nodiscard]] bool ReadTxUndo(size_t i, CTxUndo& txundo);
+};
+
 
 /**
  * Maintains a tree of blocks (stored in `m_block_index`) which is consulted
@@ -148,6 +219,19 @@ private:
     bool LoadBlockIndex(const std::optional<uint256>& snapshot_blockhash)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Populate the block index from the snapshot file written by
+     * WriteBlockIndexSnapshot(), if the block tree database has not been
+     * written to since. Besides the nonce, which only this software erases, the
+     * last block file number and info in the database must match the ones
+     * recorded in the snapshot, and the proof of work of every entry is checked
+     * as when loading from the database. Return false, leaving the block index
+     * empty, if there is no valid snapshot.
+     */
+    bool LoadBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    fs::path GetBlockIndexSnapshotPath() const { return m_opts.blocks_dir / "index.snapshot"; }
+
     /** Return false if block file or undo file flushing fails. */
     [[nodiscard]] bool FlushBlockFile(int blockfile_num, bool fFinalize, bool finalize_undo);
 
@@ -207,7 +291,7 @@ private:
         const Chainstate& chain,
         ChainstateManager& chainman);
 
-    RecursiveMutex cs_LastBlockFile;
+    mutable RecursiveMutex cs_LastBlockFile;
     std::vector<CBlockFileInfo> m_blockfile_info;
 
     //! Since assumedvalid chainstates may be syncing a range of the chain that is very
@@ -249,6 +333,15 @@ private:
     /** Dirty block file entries. */
     std::set<int> m_dirty_fileinfo;
 
+    /** Whether the block index has been loaded completely from disk. */
+    bool m_block_index_loaded GUARDED_BY(::cs_main){false};
+
+    /** Best blocks of the coins databases recorded in the block index
+     *  snapshot the block index was loaded from, if any. */
+    std::optional<std::vector<uint256>> m_index_snapshot_coins_tips GUARDED_BY(::cs_main);
+    /** Whether the block index snapshot was discarded after loading it. */
+    bool m_index_snapshot_rejected GUARDED_BY(::cs_main){false};
+
     /**
      * Map from external index name to oldest block that must not be pruned.
      *
@@ -264,6 +357,24 @@ private:
     const FlatFileSeq m_block_file_seq;
     const FlatFileSeq m_undo_file_seq;
 
+    mutable Mutex m_mapped_files_mutex;
+    //! Block files that are mapped into memory for reading, by file number.
+    mutable std::map<int, std::shared_ptr<const MappedBlockFile>> m_mapped_files GUARDED_BY(m_mapped_files_mutex);
+
+    /**
+     * Return a read-only memory map of block file file_num, or nullptr if
+     * memory-mapped reads are disabled, the file may still be written to, or
+     * it cannot be mapped. Callers then fall back to reading the file.
+     */
+    std::shared_ptr<const MappedBlockFile> GetMappedBlockFile(int file_num) const EXCLUSIVE_LOCKS_REQUIRED(!m_mapped_files_mutex);
+
+    /**
+     * Return the still obfuscated serialized block at pos in a mapped block
+     * file, after checking the header in front of it, or std::nullopt after
+     * logging an error.
+     */
+    std::optional<std::span<const std::byte>> GetMappedBlock(const MappedBlockFile& file, const FlatFilePos& pos) const;
+
 public:
     using Options = kernel::BlockManagerOpts;
 
@@ -280,7 +391,10 @@ public:
      */
     std::atomic_bool m_blockfiles_indexed{true};
 
-    BlockMap m_block_index GUARDED_BY(cs_main);
+    //! Memory the nodes of m_block_index are allocated from. Must be declared
+    //! before, and thus outlive, m_block_index.
+    BlockMapMemoryResource m_block_index_resource;
+    BlockMap m_block_index GUARDED_BY(cs_main){0, BlockHasher{}, std::equal_to<uint256>{}, &m_block_index_resource};
 
     /**
      * The height of the base block of an assumeutxo snapshot, if one is in use.
@@ -298,6 +412,9 @@ public:
 
     std::vector<CBlockIndex*> GetAllBlockIndices() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    /** All block index entries, ordered by height. */
+    std::vector<CBlockIndex*> GetAllBlockIndicesByHeight() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     /**
      * All pairs A->B, where A (or one of its ancestors) misses transactions, but B has transactions.
      * Pruned nodes may have entries where B is missing data.
@@ -310,6 +427,29 @@ public:
     bool LoadBlockIndexDB(const std::optional<uint256>& snapshot_blockhash)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    /**
+     * Write the block index to a snapshot file, which the next startup loads
+     * instead of the block tree database if the database is not written to in
+     * between. Only does so if enabled, the block index was loaded completely
+     * and all of it has been flushed to the database, so it is meant to be
+     * called after the final flush on shutdown. coins_tips are the best blocks
+     * of the flushed coins databases, which CheckIndexSnapshotCoinsTip()
+     * compares against on the next startup.
+     */
+    bool WriteBlockIndexSnapshot(const std::vector<uint256>& coins_tips) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /**
+     * If the block index was loaded from a snapshot, check that coins_tip, the
+     * best block of a coins database, is one the snapshot was written with.
+     * Otherwise another program wrote to the databases since, and the snapshot
+     * is discarded: return false, after which the block index has to be loaded
+     * again, from the database.
+     */
+    bool CheckIndexSnapshotCoinsTip(const uint256& coins_tip) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /** Whether CheckIndexSnapshotCoinsTip() discarded the block index snapshot. */
+    bool IndexSnapshotRejected() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main) { return m_index_snapshot_rejected; }
+
     /**
      * Remove any pruned block & undo files that are still on disk.
      * This could happen on some systems if the file was still being read while unlinked,
@@ -355,6 +495,9 @@ public:
     /** Whether running in -prune mode. */
     [[nodiscard]] bool IsPruneMode() const { return m_prune_mode; }
 
+    //! Number of threads reading block files ahead during -reindex, or 0 if they are read in order on the loading thread
+    [[nodiscard]] int ReindexThreads() const { return std::clamp(m_opts.reindex_threads, 0, MAX_REINDEX_THREADS); }
+
     /** Attempt to stay below this number of bytes of block files. */
     [[nodiscard]] uint64_t GetPruneTarget() const { return m_opts.prune_target; }
     static constexpr auto PRUNE_TARGET_MANUAL{std::numeric_limits<uint64_t>::max()};
@@ -418,20 +561,56 @@ public:
     /**
      *  Actually unlink the specified files
      */
-    void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const;
+    void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const EXCLUSIVE_LOCKS_REQUIRED(!m_mapped_files_mutex);
 
     /** Functions for disk access for blocks */
-    bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const;
-    bool ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) const;
-    bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos) const;
+    bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const EXCLUSIVE_LOCKS_REQUIRED(!m_mapped_files_mutex);
+    bool ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) const EXCLUSIVE_LOCKS_REQUIRED(!m_mapped_files_mutex);
+    bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos) const EXCLUSIVE_LOCKS_REQUIRED(!m_mapped_files_mutex);
+
+    /**
+     * Return the serialized block at pos as a view into its memory-mapped
+     * block file, together with the object that keeps the mapping alive, so
+     * it can be used without copying. The pages of the block are read into
+     * memory before returning. Returns std::nullopt if that is not
+     * possible: memory-mapped reads are disabled, the file is obfuscated or
+     * still written to, or the position is invalid. Use ReadRawBlockFromDisk()
+     * then.
+     */
+    std::optional<std::pair<std::shared_ptr<const void>, std::span<const std::byte>>> GetRawBlockView(const FlatFilePos& pos) const EXCLUSIVE_LOCKS_REQUIRED(!m_mapped_files_mutex);
 
     bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index) const;
 
+    /**
+     * Open a cursor over the undo data of a block, with its checksum already
+     * verified. Returns nullptr on failure. Unlike UndoReadFromDisk(), this
+     * never holds the undo data of more than one transaction in memory.
+     */
+    std::unique_ptr<BlockUndoCursor> OpenUndoCursor(const CBlockIndex& index) const;
+
     void CleanupBlockRevFiles() const;
 };
 
 // Calls ActivateBestChain() even if no blocks are imported.
 void ImportBlocks(ChainstateManager& chainman, std::span<const fs::path> import_paths);
+
+/**
+ * Write headers to a file that ImportHeaders() can load: the network magic,
+ * the number of headers as a CompactSize, then the headers in chain order.
+ */
+[[nodiscard]] bool WriteHeadersFile(const fs::path& path, const CChainParams& params, std::span<const CBlockHeader> headers);
+
+/**
+ * Load the headers in a file written by WriteHeadersFile() into the block
+ * index, instead of syncing them from peers (-loadheaders).
+ *
+ * The headers are hashed and their proof of work checked on several threads,
+ * and they must form a chain that connects to a known block and reaches the
+ * minimum chain work before any of them are accepted. They are then accepted
+ * through ProcessNewBlockHeaders(), like headers from peers that have passed
+ * the headers sync.
+ */
+bool ImportHeaders(ChainstateManager& chainman, const fs::path& path);
 } // namespace node
 
 #endif // BITCOIN_NODE_BLOCKSTORAGE_H
@@ -129,6 +129,12 @@ static ChainstateLoadResult CompleteChainstateInitialization(
             chainstate->CoinsErrorCatcher().AddReadErrCallback(options.coins_error_cb);
         }
 
+        // A block index loaded from a snapshot file only matches the coins
+        // databases it was written with.
+        if (!chainman.m_blockman.CheckIndexSnapshotCoinsTip(chainstate->CoinsDB().GetBestBlock())) {
+            return {ChainstateLoadStatus::FAILURE, _("The block index snapshot does not match the coins database")};
+        }
+
         // Refuse to load unsupported database format.
         // This is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
         if (chainstate->CoinsDB().NeedsUpgrade()) {
@@ -62,6 +62,17 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManage
     // Subtract 1 because the main thread counts towards the par threads.
     opts.worker_threads_num = script_threads - 1;
 
+    if (auto value{args.GetBoolArg("-blockprefetch")}) opts.block_prefetch = *value;
+    if (auto value{args.GetIntArg("-coinsprefetchthreads")}) opts.coins_prefetch_threads = *value;
+    if (auto value{args.GetIntArg("-parconnect")}) opts.tx_precheck_threads = *value;
+
+    if (auto value{args.GetIntArg("-dbcacheretain")}) {
+        if (*value < 0 || *value > MAX_COINS_CACHE_RETAIN_PERCENT) {
+            return util::Error{Untranslated(strprintf("-dbcacheretain must be between 0 and %d", MAX_COINS_CACHE_RETAIN_PERCENT))};
+        }
+        opts.coins_cache_retain_percent = *value;
+    }
+
     if (auto max_size = args.GetIntArg("-maxsigcachesize")) {
         // 1. When supplied with a max_size of 0, both the signature cache and
         //    script execution cache create the minimum possible cache (2
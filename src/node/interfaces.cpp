@@ -985,6 +985,9 @@ public:
     {
         BlockAssembler::Options assemble_options{options};
         ApplyArgsManOptions(*Assert(m_node.args), assemble_options);
+        if (m_node.block_template_cache && m_node.mempool) {
+            return std::make_unique<BlockTemplateImpl>(m_node.block_template_cache->Get(chainman().ActiveChainstate(), *m_node.mempool, assemble_options), m_node);
+        }
         return std::make_unique<BlockTemplateImpl>(BlockAssembler{chainman().ActiveChainstate(), context()->mempool.get(), assemble_options}.CreateNewBlock(), m_node);
     }
 
@@ -20,6 +20,7 @@
 #include <policy/policy.h>
 #include <pow.h>
 #include <primitives/transaction.h>
+#include <txmempool_clusters.h>
 #include <util/moneystr.h>
 #include <util/time.h>
 #include <validation.h>
@@ -137,7 +138,9 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock()
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
-    if (m_mempool) {
+    if (m_mempool && m_mempool->m_opts.cluster_mempool) {
+        addChunkTxs(nPackagesSelected);
+    } else if (m_mempool) {
         addPackageTxs(nPackagesSelected, nDescendantsUpdated);
     }
 
@@ -298,7 +301,10 @@ void BlockAssembler::addPackageTxs(int& nPackagesSelected, int& nDescendantsUpda
     // Keep track of entries that failed inclusion, to avoid duplicate work
     std::set<Txid> failedTx;
 
-    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
+    // mapTx does not keep an index by ancestor score, so sort it once for
+    // this block.
+    const std::vector<CTxMemPool::txiter> by_ancestor_score{mempool.GetSortedByAncestorScore()};
+    auto mi = by_ancestor_score.begin();
     CTxMemPool::txiter iter;
 
     // Limit the number of attempts to add transactions to the block when it is
@@ -307,7 +313,7 @@ void BlockAssembler::addPackageTxs(int& nPackagesSelected, int& nDescendantsUpda
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
-    while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty()) {
+    while (mi != by_ancestor_score.end() || !mapModifiedTx.empty()) {
         // First try to find a new transaction in mapTx to evaluate.
         //
         // Skip entries in mapTx that are already in a block or are present
@@ -321,8 +327,8 @@ void BlockAssembler::addPackageTxs(int& nPackagesSelected, int& nDescendantsUpda
         // cached size/sigops/fee values that are not actually correct.
         /** Return true if given transaction from mapTx has already been evaluated,
          * or if the transaction's cached data in mapTx is incorrect. */
-        if (mi != mempool.mapTx.get<ancestor_score>().end()) {
-            auto it = mempool.mapTx.project<0>(mi);
+        if (mi != by_ancestor_score.end()) {
+            auto it = *mi;
             assert(it != mempool.mapTx.end());
             if (mapModifiedTx.count(it) || inBlock.count(it->GetSharedTx()->GetHash()) || failedTx.count(it->GetSharedTx()->GetHash())) {
                 ++mi;
@@ -335,13 +341,13 @@ void BlockAssembler::addPackageTxs(int& nPackagesSelected, int& nDescendantsUpda
         bool fUsingModified = false;
 
         modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == mempool.mapTx.get<ancestor_score>().end()) {
+        if (mi == by_ancestor_score.end()) {
             // We're out of entries in mapTx; use the entry from mapModifiedTx
             iter = modit->iter;
             fUsingModified = true;
         } else {
             // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = mempool.mapTx.project<0>(mi);
+            iter = *mi;
             if (modit != mapModifiedTx.get<ancestor_score>().end() &&
                     CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(iter))) {
                 // The best entry in mapModifiedTx has higher score
@@ -427,4 +433,179 @@ void BlockAssembler::addPackageTxs(int& nPackagesSelected, int& nDescendantsUpda
         nDescendantsUpdated += UpdatePackagesForAdded(mempool, ancestors, mapModifiedTx);
     }
 }
+
+// Chunks are already sorted by feerate and each chunk's in-cluster
+// dependencies come in earlier chunks, so unlike addPackageTxs() there is no
+// ancestor state to keep up to date as transactions are added. When a chunk
+// cannot be added, the remaining chunks of its cluster are skipped, since
+// they may depend on it.
+void BlockAssembler::addChunkTxs(int& nPackagesSelected)
+{
+    const auto& mempool{*Assert(m_mempool)};
+    LOCK(mempool.cs);
+    const TxMemPoolClusters& clusters{mempool.GetClusters()};
+
+    std::set<uint64_t> skipped_clusters;
+
+    // See addPackageTxs().
+    const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
+    int64_t nConsecutiveFailed = 0;
+
+    for (const TxMemPoolClusters::ChunkRef& ref : clusters.GetChunks()) {
+        if (skipped_clusters.count(ref.cluster_id)) continue;
+
+        if (ref.feerate.fee < m_options.blockMinFeeRate.GetFee(ref.feerate.size)) {
+            // Everything else we might consider has a lower fee rate
+            return;
+        }
+
+        const TxMemPoolClusters::Chunk& chunk{clusters.GetChunk(ref)};
+        CTxMemPool::setEntries package;
+        int64_t packageSigOpsCost{0};
+        for (const CTxMemPoolEntry* entry : chunk.txs) {
+            package.insert(mempool.mapTx.iterator_to(*entry));
+            packageSigOpsCost += entry->GetSigOpCost();
+        }
+
+        // Chunks of a split cluster may depend on transactions in another
+        // piece, which have to be in the block already.
+        bool parents_included{true};
+        for (const CTxMemPoolEntry* entry : chunk.txs) {
+            for (const CTxMemPoolEntry& parent : entry->GetMemPoolParentsConst()) {
+                if (!inBlock.count(parent.GetSharedTx()->GetHash()) && !package.count(mempool.mapTx.iterator_to(parent))) {
+                    parents_included = false;
+                }
+            }
+        }
+
+        if (!parents_included || !TestPackage(ref.feerate.size, packageSigOpsCost)) {
+            skipped_clusters.insert(ref.cluster_id);
+            ++nConsecutiveFailed;
+
+            if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
+                    m_options.nBlockMaxWeight - m_options.coinbase_max_additional_weight) {
+                // Give up if we're close to full and haven't succeeded in a while
+                break;
+            }
+            continue;
+        }
+
+        if (!TestPackageTransactions(package)) {
+            skipped_clusters.insert(ref.cluster_id);
+            continue;
+        }
+
+        // This chunk will make it in; reset the failed counter.
+        nConsecutiveFailed = 0;
+
+        // The linearization order is a valid order within the chunk.
+        for (const CTxMemPoolEntry* entry : chunk.txs) {
+            AddToBlock(mempool.mapTx.iterator_to(*entry));
+        }
+
+        ++nPackagesSelected;
+        pblocktemplate->m_package_feerates.emplace_back(ref.feerate);
+    }
+}
+
+static bool SameOptions(const BlockAssembler::Options& a, const BlockAssembler::Options& b)
+{
+    return a.use_mempool == b.use_mempool &&
+           a.coinbase_max_additional_weight == b.coinbase_max_additional_weight &&
+           a.coinbase_output_max_additional_sigops == b.coinbase_output_max_additional_sigops &&
+           a.coinbase_output_script == b.coinbase_output_script &&
+           a.nBlockMaxWeight == b.nBlockMaxWeight &&
+           a.blockMinFeeRate == b.blockMinFeeRate &&
+           a.test_block_validity == b.test_block_validity &&
+           a.print_modified_fee == b.print_modified_fee;
+}
+
+bool BlockTemplateCache::IsCurrent(const Chainstate& chainstate, const CTxMemPool& mempool, const BlockAssembler::Options& options) const
+{
+    AssertLockHeld(m_mutex);
+    AssertLockHeld(::cs_main);
+    AssertLockHeld(mempool.cs);
+    if (!m_template || m_stale || !SameOptions(options, m_options)) return false;
+    if (chainstate.m_chain.Tip()->GetBlockHash() != m_tip) return false;
+    // Changes that are not notified, or whose notification is still queued.
+    if (mempool.GetTransactionsUpdated() != m_transactions_updated) return false;
+    if (!options.use_mempool) return true;
+
+    for (const Txid& txid : m_added) {
+        const auto it{mempool.GetIter(txid)};
+        // Removed again, without having been in the template.
+        if (!it) continue;
+        const CTxMemPoolEntry& entry{**it};
+        // It is selected as part of a package, with its ancestors or as part
+        // of a chunk, which may pay a higher feerate than it does on its own.
+        FeeFrac feerate{entry.GetModifiedFee(), entry.GetTxSize()};
+        const FeeFrac ancestor_feerate{entry.GetModFeesWithAncestors(), static_cast<int32_t>(entry.GetSizeWithAncestors())};
+        if (ancestor_feerate >> feerate) feerate = ancestor_feerate;
+        if (mempool.m_opts.cluster_mempool) {
+            const auto chunk_feerate{mempool.GetClusters().GetChunkFeerate(entry)};
+            if (chunk_feerate && *chunk_feerate >> feerate) feerate = *chunk_feerate;
+        }
+        if (feerate.fee < options.blockMinFeeRate.GetFee(feerate.size)) continue;
+        if (WITNESS_SCALE_FACTOR * static_cast<uint64_t>(entry.GetTxSize()) < m_weight_left) return false;
+        if (m_min_package_feerate && !(feerate << *m_min_package_feerate)) return false;
+    }
+    return true;
+}
+
+std::unique_ptr<CBlockTemplate> BlockTemplateCache::Get(Chainstate& chainstate, const CTxMemPool& mempool, const BlockAssembler::Options& options)
+{
+    // Holding cs_main keeps the tip, and all mempool changes but
+    // prioritisation, from changing while the template is built.
+    LOCK(::cs_main);
+    unsigned int transactions_updated;
+    {
+        LOCK2(mempool.cs, m_mutex);
+        if (IsCurrent(chainstate, mempool, options)) {
+            m_added.clear();
+            auto block_template{std::make_unique<CBlockTemplate>(*m_template)};
+            // Refresh the header fields CreateNewBlock() takes from the clock.
+            UpdateTime(&block_template->block, chainstate.m_chainman.GetConsensus(), chainstate.m_chain.Tip());
+            block_template->block.nNonce = 0;
+            return block_template;
+        }
+        transactions_updated = mempool.GetTransactionsUpdated();
+    }
+
+    std::unique_ptr<CBlockTemplate> block_template{BlockAssembler{chainstate, &mempool, options}.CreateNewBlock()};
+
+    LOCK(m_mutex);
+    m_options = options;
+    m_tip = chainstate.m_chain.Tip()->GetBlockHash();
+    m_transactions_updated = transactions_updated;
+    m_stale = false;
+    m_added.clear();
+    m_txids.clear();
+    uint64_t weight{m_options.coinbase_max_additional_weight};
+    for (size_t i = 1; i < block_template->block.vtx.size(); ++i) {
+        m_txids.insert(block_template->block.vtx[i]->GetHash());
+        weight += GetTransactionWeight(*block_template->block.vtx[i]);
+    }
+    const size_t max_weight{ClampOptions(m_options).nBlockMaxWeight};
+    m_weight_left = max_weight > weight ? max_weight - weight : 0;
+    m_min_package_feerate.reset();
+    for (const FeeFrac& feerate : block_template->m_package_feerates) {
+        if (!m_min_package_feerate || feerate << *m_min_package_feerate) m_min_package_feerate = feerate;
+    }
+    m_template = std::make_unique<const CBlockTemplate>(*block_template);
+    return block_template;
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence)
+{
+    LOCK(m_mutex);
+    ++m_transactions_updated;
+    m_added.push_back(tx.info.m_tx->GetHash());
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    LOCK(m_mutex);
+    ++m_transactions_updated;
+    if (m_txids.count(tx->GetHash())) m_stale = true;
+}
 } // namespace node
@@ -9,8 +9,10 @@
 #include <node/types.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
 #include <util/feefrac.h>
+#include <validationinterface.h>
 
 #include <memory>
 #include <optional>
@@ -33,6 +35,7 @@ namespace Consensus { struct Params; };
 
 namespace node {
 static const bool DEFAULT_PRINT_MODIFIED_FEE = false;
+static const bool DEFAULT_BLOCK_TEMPLATE_CACHE = true;
 
 struct CBlockTemplate
 {
@@ -197,6 +200,14 @@ private:
     */
     void addPackageTxs(int& nPackagesSelected, int& nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(!m_mempool->cs);
 
+    /** Add transactions chunk by chunk, by decreasing chunk feerate, from
+      * the linearized clusters of a mempool in cluster mode.
+      * Increments nPackagesSelected with the number of chunks added.
+      *
+      * @pre BlockAssembler::m_mempool must not be nullptr
+    */
+    void addChunkTxs(int& nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(!m_mempool->cs);
+
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
     void onlyUnconfirmed(CTxMemPool::setEntries& testSet);
@@ -211,6 +222,56 @@ private:
     void SortForBlock(const CTxMemPool::setEntries& package, std::vector<CTxMemPool::txiter>& sortedEntries);
 };
 
+/**
+ * Keeps the last block template and serves copies of it for as long as
+ * nothing that could change it has happened since it was built.
+ *
+ * Mempool additions and removals are learnt from the validation interface.
+ * Removing a transaction that is not in the template leaves it unchanged, and
+ * so does adding one whose feerate is below blockMinFeeRate, or below the
+ * lowest package feerate in the template when it does not fit in what is left
+ * of the block. The feerate compared is the highest of its own, its ancestor
+ * and (in cluster mode) its chunk feerate. Ancestors it does not share with
+ * the template were not selected, so no package containing it can be selected
+ * either. Any other change, including ones that are not notified
+ * (prioritisation, transactions not added through validation), a new tip or
+ * different options cause the template to be rebuilt. The time and nonce of a
+ * cached template are reset as if it had just been built.
+ */
+class BlockTemplateCache : public CValidationInterface
+{
+public:
+    /** Return a copy of the cached template if it is still current, or else a newly built one. */
+    std::unique_ptr<CBlockTemplate> Get(Chainstate& chainstate, const CTxMemPool& mempool, const BlockAssembler::Options& options)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex, !mempool.cs);
+
+protected:
+    void TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override
+        EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    /** Whether the cached template is still what BlockAssembler would build. */
+    bool IsCurrent(const Chainstate& chainstate, const CTxMemPool& mempool, const BlockAssembler::Options& options) const
+        EXCLUSIVE_LOCKS_REQUIRED(m_mutex, ::cs_main, mempool.cs);
+
+    mutable Mutex m_mutex;
+    std::unique_ptr<const CBlockTemplate> m_template GUARDED_BY(m_mutex);
+    BlockAssembler::Options m_options GUARDED_BY(m_mutex);
+    uint256 m_tip GUARDED_BY(m_mutex);
+    /** Value CTxMemPool::GetTransactionsUpdated() would have if all changes since the template was built were notified. */
+    unsigned int m_transactions_updated GUARDED_BY(m_mutex){0};
+    /** Set when a transaction in the template was removed from the mempool. */
+    bool m_stale GUARDED_BY(m_mutex){true};
+    /** Transactions added to the mempool since the template was built. */
+    std::vector<Txid> m_added GUARDED_BY(m_mutex);
+    std::unordered_set<Txid, SaltedTxidHasher> m_txids GUARDED_BY(m_mutex);
+    /** Lowest feerate of the packages in the template, and the weight left in the block. */
+    std::optional<FeeFrac> m_min_package_feerate GUARDED_BY(m_mutex);
+    uint64_t m_weight_left GUARDED_BY(m_mutex){0};
+};
+
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 /** Update an old GenerateCoinbaseCommitment from CreateNewBlock after the block txs have changed */
@@ -5,14 +5,33 @@
 
 #include <primitives/block.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 
+#include <cassert>
+
 uint256 CBlockHeader::GetHash() const
 {
     return (HashWriter{} << *this).GetHash();
 }
 
+std::vector<uint256> GetBlockHeaderHashes(std::span<const CBlockHeader> headers)
+{
+    if (headers.empty()) return {};
+    std::vector<unsigned char> serialized;
+    serialized.reserve(headers.size() * BLOCK_HEADER_SIZE);
+    VectorWriter writer{serialized, 0};
+    for (const CBlockHeader& header : headers) {
+        writer << header;
+    }
+    assert(serialized.size() == headers.size() * BLOCK_HEADER_SIZE);
+    std::vector<uint256> hashes(headers.size());
+    SHA256D80(hashes[0].begin(), serialized.data(), headers.size());
+    return hashes;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
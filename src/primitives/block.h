@@ -11,6 +11,9 @@
 #include <uint256.h>
 #include <util/time.h>
 
+#include <span>
+#include <vector>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -64,6 +67,15 @@ public:
     }
 };
 
+/** Serialized size of a block header. */
+static constexpr size_t BLOCK_HEADER_SIZE{80};
+
+/**
+ * Compute the hashes of a batch of block headers, several at a time where the
+ * hardware allows it. Equivalent to calling GetHash() on each of them.
+ */
+std::vector<uint256> GetBlockHeaderHashes(std::span<const CBlockHeader> headers);
+
 
 class CBlock : public CBlockHeader
 {
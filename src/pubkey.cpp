@@ -235,6 +235,24 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_static, sigbytes.data(), msg.begin(), 32, &pubkey);
 }
 
+void SchnorrBatch::Add(const XOnlyPubKey& pubkey, Span<const unsigned char> sigbytes, const uint256& msg)
+{
+    assert(sigbytes.size() == 64);
+    Entry entry{pubkey, {}, msg};
+    std::copy(sigbytes.begin(), sigbytes.end(), entry.sig.begin());
+    m_entries.push_back(entry);
+}
+
+bool SchnorrBatch::Verify() const
+{
+    // The bundled libsecp256k1 does not offer batch verification yet, so the
+    // signatures are checked in turn. This is the single place to switch over
+    // once it does; callers already defer and fall back on failure.
+    return std::all_of(m_entries.begin(), m_entries.end(), [](const Entry& entry) {
+        return entry.pubkey.VerifySchnorr(entry.msg, entry.sig);
+    });
+}
+
 static const HashWriter HASHER_TAPTWEAK{TaggedHash("TapTweak")};
 
 uint256 XOnlyPubKey::ComputeTapTweakHash(const uint256* merkle_root) const
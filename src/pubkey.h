@@ -12,6 +12,7 @@
 #include <span.h>
 #include <uint256.h>
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <vector>
@@ -305,6 +306,39 @@ public:
     SERIALIZE_METHODS(XOnlyPubKey, obj) { READWRITE(obj.m_keydata); }
 };
 
+/** A set of Schnorr signature checks that are verified together.
+ *
+ * Verify() succeeds only if every signature that was added is valid; it does
+ * not tell which one is not. Callers that need to know check the signatures
+ * one by one again when the batch fails.
+ */
+class SchnorrBatch
+{
+private:
+    struct Entry {
+        XOnlyPubKey pubkey;
+        std::array<unsigned char, 64> sig;
+        uint256 msg;
+    };
+    std::vector<Entry> m_entries;
+
+public:
+    /** Whether Verify() is cheaper than checking the signatures one by one.
+     *  The bundled libsecp256k1 has no batch verification yet, so until it
+     *  does, deferring signatures to a batch only adds work. */
+    static constexpr bool IS_BATCHED{false};
+
+    /** Add a check of signature sigbytes (exactly 64 bytes) on msg by pubkey. */
+    void Add(const XOnlyPubKey& pubkey, Span<const unsigned char> sigbytes, const uint256& msg);
+
+    /** Verify all signatures added so far. An empty batch is valid. */
+    bool Verify() const;
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    void clear() { m_entries.clear(); }
+};
+
 /** An ElligatorSwift-encoded public key. */
 struct EllSwiftPubKey
 {
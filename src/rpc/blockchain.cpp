@@ -70,15 +70,16 @@ using node::NodeContext;
 using node::SnapshotMetadata;
 using util::MakeUnorderedList;
 
-std::tuple<std::unique_ptr<CCoinsViewCursor>, CCoinsStats, const CBlockIndex*>
+std::tuple<std::vector<std::unique_ptr<CCoinsViewCursor>>, CCoinsStats, const CBlockIndex*>
 PrepareUTXOSnapshot(
     Chainstate& chainstate,
-    const std::function<void()>& interruption_point = {})
+    const std::function<void()>& interruption_point = {},
+    unsigned int num_threads = kernel::DefaultUTXOReadThreads())
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
 UniValue WriteUTXOSnapshot(
     Chainstate& chainstate,
-    CCoinsViewCursor* pcursor,
+    std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors,
     CCoinsStats* maybe_stats,
     const CBlockIndex* tip,
     AutoFile& afile,
@@ -3058,7 +3059,7 @@ static RPCHelpMan dumptxoutset()
     }
 
     Chainstate* chainstate;
-    std::unique_ptr<CCoinsViewCursor> cursor;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
     CCoinsStats stats;
     {
         // Lock the chainstate before calling PrepareUtxoSnapshot, to be able
@@ -3079,11 +3080,11 @@ static RPCHelpMan dumptxoutset()
             LogWarning("dumptxoutset failed to roll back to requested height, reverting to tip.\n");
             throw JSONRPCError(RPC_MISC_ERROR, "Could not roll back to requested height.");
         } else {
-            std::tie(cursor, stats, tip) = PrepareUTXOSnapshot(*chainstate, node.rpc_interruption_point);
+            std::tie(cursors, stats, tip) = PrepareUTXOSnapshot(*chainstate, node.rpc_interruption_point);
         }
     }
 
-    UniValue result = WriteUTXOSnapshot(*chainstate, cursor.get(), &stats, tip, afile, path, temppath, node.rpc_interruption_point);
+    UniValue result = WriteUTXOSnapshot(*chainstate, cursors, &stats, tip, afile, path, temppath, node.rpc_interruption_point);
     fs::rename(temppath, path);
 
     result.pushKV("path", path.utf8string());
@@ -3092,23 +3093,24 @@ static RPCHelpMan dumptxoutset()
     };
 }
 
-std::tuple<std::unique_ptr<CCoinsViewCursor>, CCoinsStats, const CBlockIndex*>
+std::tuple<std::vector<std::unique_ptr<CCoinsViewCursor>>, CCoinsStats, const CBlockIndex*>
 PrepareUTXOSnapshot(
     Chainstate& chainstate,
-    const std::function<void()>& interruption_point)
+    const std::function<void()>& interruption_point,
+    unsigned int num_threads)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
     std::optional<CCoinsStats> maybe_stats;
     const CBlockIndex* tip;
 
     {
         // We need to lock cs_main to ensure that the coinsdb isn't written to
         // between (i) flushing coins cache to disk (coinsdb), (ii) getting stats
-        // based upon the coinsdb, and (iii) constructing a cursor to the
+        // based upon the coinsdb, and (iii) constructing cursors to the
         // coinsdb for use in WriteUTXOSnapshot.
         //
         // Cursors returned by leveldb iterate over snapshots, so the contents
-        // of the pcursor will not be affected by simultaneous writes during
+        // of the cursors will not be affected by simultaneous writes during
         // use below this block.
         //
         // See discussion here:
@@ -3123,31 +3125,21 @@ PrepareUTXOSnapshot(
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
         }
 
-        pcursor = chainstate.CoinsDB().Cursor();
+        // Read the coins on several threads if the database supports it.
+        if (num_threads > 1) cursors = chainstate.CoinsDB().SnapshotCursors(num_threads);
+        if (cursors.empty()) cursors.push_back(chainstate.CoinsDB().Cursor());
         tip = CHECK_NONFATAL(chainstate.m_blockman.LookupBlockIndex(maybe_stats->hashBlock));
     }
 
-    return {std::move(pcursor), *CHECK_NONFATAL(maybe_stats), tip};
+    return {std::move(cursors), *CHECK_NONFATAL(maybe_stats), tip};
 }
 
-UniValue WriteUTXOSnapshot(
-    Chainstate& chainstate,
-    CCoinsViewCursor* pcursor,
-    CCoinsStats* maybe_stats,
-    const CBlockIndex* tip,
-    AutoFile& afile,
-    const fs::path& path,
-    const fs::path& temppath,
-    const std::function<void()>& interruption_point)
+//! Write the coins from the cursor position up to the first transaction whose
+//! txid is not lower than end (or to the end of the view) to the stream, and
+//! return the number of coins written.
+template <typename Stream>
+static size_t WriteSnapshotCoins(Stream& stream, CCoinsViewCursor& cursor, const std::optional<Txid>& end, const std::function<void()>& interruption_point)
 {
-    LOG_TIME_SECONDS(strprintf("writing UTXO snapshot at height %s (%s) to file %s (via %s)",
-        tip->nHeight, tip->GetBlockHash().ToString(),
-        fs::PathToString(path), fs::PathToString(temppath)));
-
-    SnapshotMetadata metadata{chainstate.m_chainman.GetParams().MessageStart(), tip->GetBlockHash(), maybe_stats->coins_count};
-
-    afile << metadata;
-
     COutPoint key;
     Txid last_hash;
     Coin coin;
@@ -3162,35 +3154,92 @@ UniValue WriteUTXOSnapshot(
     // (key.hash) and when we have them all (key.hash != last_hash) we write
     // them to file using the below lambda function.
     // See also https://github.com/bitcoin/bitcoin/issues/25675
-    auto write_coins_to_file = [&](AutoFile& afile, const Txid& last_hash, const std::vector<std::pair<uint32_t, Coin>>& coins, size_t& written_coins_count) {
-        afile << last_hash;
-        WriteCompactSize(afile, coins.size());
+    auto write_coins_to_file = [&](Stream& stream, const Txid& last_hash, const std::vector<std::pair<uint32_t, Coin>>& coins, size_t& written_coins_count) {
+        stream << last_hash;
+        WriteCompactSize(stream, coins.size());
         for (const auto& [n, coin] : coins) {
-            WriteCompactSize(afile, n);
-            afile << coin;
+            WriteCompactSize(stream, n);
+            stream << coin;
             ++written_coins_count;
         }
     };
 
-    pcursor->GetKey(key);
+    cursor.GetKey(key);
     last_hash = key.hash;
-    while (pcursor->Valid()) {
-        if (iter % 5000 == 0) interruption_point();
+    while (cursor.Valid()) {
+        if (interruption_point && iter % 5000 == 0) interruption_point();
         ++iter;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+        if (cursor.GetKey(key) && cursor.GetValue(coin)) {
+            if (end && !(key.hash < *end)) break;
             if (key.hash != last_hash) {
-                write_coins_to_file(afile, last_hash, coins, written_coins_count);
+                write_coins_to_file(stream, last_hash, coins, written_coins_count);
                 last_hash = key.hash;
                 coins.clear();
             }
             coins.emplace_back(key.n, coin);
         }
-        pcursor->Next();
+        cursor.Next();
     }
 
     if (!coins.empty()) {
-        write_coins_to_file(afile, last_hash, coins, written_coins_count);
+        write_coins_to_file(stream, last_hash, coins, written_coins_count);
     }
+    return written_coins_count;
+}
+
+//! Coins of a range of the UTXO set, serialized as in the snapshot file.
+struct SnapshotChunk {
+    DataStream data;
+    size_t coins_count{0};
+};
+
+//! Write the coins with one thread per cursor, each serializing ranges of the
+//! UTXO set into chunks, while this thread writes the chunks to the file in
+//! order.
+static size_t WriteSnapshotCoinsParallel(AutoFile& afile, std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors, const std::function<void()>& interruption_point)
+{
+    std::vector<std::optional<SnapshotChunk>> chunks(kernel::UTXO_SET_RANGES);
+    size_t written_coins_count{0};
+    const bool success{kernel::ReadUTXOSetRanges(
+        cursors, "dumptxoutset",
+        [&](CCoinsViewCursor& cursor, const std::optional<Txid>& end, size_t range) {
+            auto& chunk{chunks[range].emplace()};
+            chunk.coins_count = WriteSnapshotCoins(chunk.data, cursor, end, {});
+            return true;
+        },
+        [&](size_t range) {
+            afile.write(chunks[range]->data);
+            written_coins_count += chunks[range]->coins_count;
+            chunks[range].reset();
+        },
+        interruption_point)};
+    if (!success) throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+    return written_coins_count;
+}
+
+UniValue WriteUTXOSnapshot(
+    Chainstate& chainstate,
+    std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors,
+    CCoinsStats* maybe_stats,
+    const CBlockIndex* tip,
+    AutoFile& afile,
+    const fs::path& path,
+    const fs::path& temppath,
+    const std::function<void()>& interruption_point)
+{
+    LOG_TIME_SECONDS(strprintf("writing UTXO snapshot at height %s (%s) to file %s (via %s)",
+        tip->nHeight, tip->GetBlockHash().ToString(),
+        fs::PathToString(path), fs::PathToString(temppath)));
+
+    SnapshotMetadata metadata{chainstate.m_chainman.GetParams().MessageStart(), tip->GetBlockHash(), maybe_stats->coins_count};
+
+    afile << metadata;
+
+    // Every range of the UTXO set holds all coins of the transactions in it,
+    // so writing the ranges in order gives the same file as a single cursor.
+    const size_t written_coins_count{cursors.size() > 1 ?
+        WriteSnapshotCoinsParallel(afile, cursors, interruption_point) :
+        WriteSnapshotCoins(afile, *CHECK_NONFATAL(cursors.at(0)), std::nullopt, interruption_point)};
 
     CHECK_NONFATAL(written_coins_count == maybe_stats->coins_count);
 
@@ -3211,10 +3260,11 @@ UniValue CreateUTXOSnapshot(
     Chainstate& chainstate,
     AutoFile& afile,
     const fs::path& path,
-    const fs::path& tmppath)
+    const fs::path& tmppath,
+    unsigned int num_threads)
 {
-    auto [cursor, stats, tip]{WITH_LOCK(::cs_main, return PrepareUTXOSnapshot(chainstate, node.rpc_interruption_point))};
-    return WriteUTXOSnapshot(chainstate, cursor.get(), &stats, tip, afile, path, tmppath, node.rpc_interruption_point);
+    auto [cursors, stats, tip]{WITH_LOCK(::cs_main, return PrepareUTXOSnapshot(chainstate, node.rpc_interruption_point, num_threads))};
+    return WriteUTXOSnapshot(chainstate, cursors, &stats, tip, afile, path, tmppath, node.rpc_interruption_point);
 }
 
 static RPCHelpMan loadtxoutset()
@@ -3367,6 +3417,122 @@ return RPCHelpMan{
     };
 }
 
+static RPCHelpMan getcoinscacheinfo()
+{
+return RPCHelpMan{
+        "getcoinscacheinfo",
+        "\nReturn statistics about the in-memory coins cache of the active chainstate and how it has been written to disk.\n",
+        {},
+        RPCResult{
+            RPCResult::Type::OBJ, "", "", {
+                {RPCResult::Type::NUM, "coins", "the number of coins currently in the cache"},
+                {RPCResult::Type::NUM, "usage", "the memory used by the cache, in bytes"},
+                {RPCResult::Type::NUM, "max_usage", "the size the cache may grow to before it is written to disk, in bytes"},
+                {RPCResult::Type::NUM, "hits", "the number of lookups answered from the cache"},
+                {RPCResult::Type::NUM, "misses", "the number of lookups that had to consult the coins database"},
+                {RPCResult::Type::NUM, "hit_ratio", "hits divided by the total number of lookups"},
+                {RPCResult::Type::NUM, "flushes", "the number of times the cache was written to disk"},
+                {RPCResult::Type::NUM, "partial_flushes", "how many of those kept the most recently created coins in the cache (see -dbcacheretain)"},
+                {RPCResult::Type::NUM, "coins_written", "the number of modified coins written to disk"},
+                {RPCResult::Type::NUM, "coins_evicted", "the number of unmodified coins dropped from the cache by partial flushes"},
+                {RPCResult::Type::NUM, "last_flush_stall", "how long block processing was stalled by the most recent flush, in milliseconds"},
+            }
+        },
+        RPCExamples{
+            HelpExampleCli("getcoinscacheinfo", "")
+    + HelpExampleRpc("getcoinscacheinfo", "")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    LOCK(cs_main);
+    Chainstate& active_chainstate = chainman.ActiveChainstate();
+    const CCoinsViewCache& coins_tip = active_chainstate.CoinsTip();
+    const CoinsFlushStats& stats = active_chainstate.m_coins_flush_stats;
+
+    const uint64_t hits{coins_tip.GetCacheHits()};
+    const uint64_t misses{coins_tip.GetCacheMisses()};
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("coins", uint64_t{coins_tip.GetCacheSize()});
+    obj.pushKV("usage", uint64_t{coins_tip.DynamicMemoryUsage()});
+    obj.pushKV("max_usage", uint64_t{active_chainstate.m_coinstip_cache_size_bytes});
+    obj.pushKV("hits", hits);
+    obj.pushKV("misses", misses);
+    obj.pushKV("hit_ratio", hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0);
+    obj.pushKV("flushes", stats.flushes);
+    obj.pushKV("partial_flushes", stats.partial_flushes);
+    obj.pushKV("coins_written", stats.coins_written);
+    obj.pushKV("coins_evicted", stats.coins_evicted);
+    obj.pushKV("last_flush_stall", Ticks<MillisecondsDouble>(stats.last_stall));
+    return obj;
+}
+    };
+}
+
+
+static RPCHelpMan dumpheaders()
+{
+    return RPCHelpMan{
+        "dumpheaders",
+        "Write the headers of the active chain, after the genesis block, to a file that another node can load with -loadheaders instead of syncing headers from peers.\n",
+        {
+            {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::NUM, "headers_written", "the number of headers written"},
+                    {RPCResult::Type::STR_HEX, "tip_hash", "the hash of the last header written"},
+                    {RPCResult::Type::STR, "path", "the absolute path that the headers were written to"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("dumpheaders", "headers.dat")
+    + HelpExampleRpc("dumpheaders", "\"headers.dat\"")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    const ArgsManager& args{EnsureAnyArgsman(request.context)};
+    const fs::path path = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str()));
+    // Write to a temporary path and then move into `path` on completion
+    // to avoid confusion due to an interruption.
+    const fs::path temppath = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str() + ".incomplete"));
+
+    if (fs::exists(path)) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            path.utf8string() + " already exists. If you are sure this is what you want, "
+            "move it out of the way first");
+    }
+
+    std::vector<CBlockHeader> headers;
+    uint256 tip_hash;
+    {
+        LOCK(cs_main);
+        const CChain& chain{chainman.ActiveChain()};
+        headers.reserve(chain.Height());
+        for (int height = 1; height <= chain.Height(); ++height) {
+            headers.push_back(chain[height]->GetBlockHeader());
+        }
+        tip_hash = chain.Tip()->GetBlockHash();
+    }
+
+    if (!node::WriteHeadersFile(temppath, chainman.GetParams(), headers)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Couldn't write headers to " + temppath.utf8string());
+    }
+    fs::rename(temppath, path);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("headers_written", uint64_t{headers.size()});
+    result.pushKV("tip_hash", tip_hash.GetHex());
+    result.pushKV("path", path.utf8string());
+    return result;
+}
+    };
+}
+
 
 void RegisterBlockchainRPCCommands(CRPCTable& t)
 {
@@ -3393,8 +3559,10 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &getdescriptoractivity},
         {"blockchain", &getblockfilter},
         {"blockchain", &dumptxoutset},
+        {"blockchain", &dumpheaders},
         {"blockchain", &loadtxoutset},
         {"blockchain", &getchainstates},
+        {"blockchain", &getcoinscacheinfo},
         {"hidden", &invalidateblock},
         {"hidden", &reconsiderblock},
         {"hidden", &waitfornewblock},
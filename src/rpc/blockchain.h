@@ -7,6 +7,7 @@
 
 #include <consensus/amount.h>
 #include <core_io.h>
+#include <kernel/coinstats.h>
 #include <streams.h>
 #include <sync.h>
 #include <util/fs.h>
@@ -46,6 +47,7 @@ void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES],
 
 /**
  * Test-only helper to create UTXO snapshots given a chainstate and a file handle.
+ * @param[in] num_threads  Number of threads the UTXO set is read on
  * @return a UniValue map containing metadata about the snapshot.
  */
 UniValue CreateUTXOSnapshot(
@@ -53,7 +55,8 @@ UniValue CreateUTXOSnapshot(
     Chainstate& chainstate,
     AutoFile& afile,
     const fs::path& path,
-    const fs::path& tmppath);
+    const fs::path& tmppath,
+    unsigned int num_threads = kernel::DefaultUTXOReadThreads());
 
 //! Return height of highest block that has been pruned, or std::nullopt if no blocks have been pruned
 std::optional<int> GetPruneHeight(const node::BlockManager& blockman, const CChain& chain) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
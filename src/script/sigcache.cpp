@@ -78,7 +78,26 @@ bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsig
     uint256 entry;
     m_signature_cache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
     if (m_signature_cache.Get(entry, !store)) return true;
+    if (m_deferred) {
+        m_deferred->Add(sig, pubkey, sighash, store ? &m_signature_cache : nullptr, entry);
+        return true;
+    }
     if (!TransactionSignatureChecker::VerifySchnorrSignature(sig, pubkey, sighash)) return false;
     if (store) m_signature_cache.Set(entry);
     return true;
 }
+
+void DeferredSchnorrChecks::Add(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash, SignatureCache* signature_cache, const uint256& entry)
+{
+    m_batch.Add(pubkey, sig, sighash);
+    if (signature_cache) m_cache_entries.emplace_back(signature_cache, entry);
+}
+
+bool DeferredSchnorrChecks::Verify()
+{
+    if (!m_batch.Verify()) return false;
+    for (const auto& [signature_cache, entry] : m_cache_entries) {
+        signature_cache->Set(entry);
+    }
+    return true;
+}
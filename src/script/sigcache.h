@@ -9,6 +9,7 @@
 #include <consensus/amount.h>
 #include <crypto/sha256.h>
 #include <cuckoocache.h>
+#include <pubkey.h>
 #include <script/interpreter.h>
 #include <span.h>
 #include <uint256.h>
@@ -16,6 +17,7 @@
 
 #include <cstddef>
 #include <shared_mutex>
+#include <utility>
 #include <vector>
 
 class CPubKey;
@@ -60,14 +62,36 @@ public:
     void Set(const uint256& entry);
 };
 
+/**
+ * Schnorr signature checks that were deferred by CachingTransactionSignatureChecker,
+ * together with the signature cache entries to add once they are known to be valid.
+ */
+class DeferredSchnorrChecks
+{
+private:
+    SchnorrBatch m_batch;
+    std::vector<std::pair<SignatureCache*, uint256>> m_cache_entries;
+
+public:
+    /** Defer a signature check. If signature_cache is not nullptr, entry is added to it when the check passes. */
+    void Add(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash, SignatureCache* signature_cache, const uint256& entry);
+
+    /** Verify all deferred checks, and store their cache entries if they all pass. */
+    bool Verify();
+
+    bool empty() const { return m_batch.empty(); }
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
     SignatureCache& m_signature_cache;
+    //! If not nullptr, Schnorr signatures missing from the cache are collected here and assumed to be valid.
+    DeferredSchnorrChecks* m_deferred;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, SignatureCache& signature_cache, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn, MissingDataBehavior::ASSERT_FAIL), store(storeIn), m_signature_cache(signature_cache)  {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, SignatureCache& signature_cache, PrecomputedTransactionData& txdataIn, DeferredSchnorrChecks* deferred = nullptr) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn, MissingDataBehavior::ASSERT_FAIL), store(storeIn), m_signature_cache(signature_cache), m_deferred(deferred)  {}
 
     bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
     bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
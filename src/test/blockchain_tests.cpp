@@ -7,11 +7,19 @@
 #include <chain.h>
 #include <node/blockstorage.h>
 #include <rpc/blockchain.h>
+#include <streams.h>
 #include <sync.h>
 #include <test/util/setup_common.h>
+#include <tinyformat.h>
+#include <univalue.h>
+#include <util/fs.h>
 #include <util/string.h>
+#include <validation.h>
 
 #include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
 
 using util::ToString;
 
@@ -110,6 +118,24 @@ BOOST_FIXTURE_TEST_CASE(get_prune_height, TestChain100Setup)
     CheckGetPruneHeight(blockman, chain, 100);
 }
 
+BOOST_FIXTURE_TEST_CASE(dumptxoutset_parallel, TestChain100Setup)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    const auto dump{[&](unsigned int num_threads) {
+        const fs::path path{m_path_root / fs::u8path(strprintf("utxo_snapshot.%u.dat", num_threads))};
+        AutoFile afile{fsbridge::fopen(path, "wb")};
+        CreateUTXOSnapshot(m_node, chainstate, afile, path, path, num_threads);
+        std::ifstream file{path, std::ios::binary};
+        return std::vector<char>{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }};
+
+    // Reading the UTXO set on several threads writes the same file as
+    // reading it with a single cursor.
+    const std::vector<char> serial{dump(1)};
+    BOOST_CHECK_GT(serial.size(), 100U * 36);
+    BOOST_CHECK(dump(4) == serial);
+}
+
 BOOST_AUTO_TEST_CASE(num_chain_tx_max)
 {
     CBlockIndex block_index{};
@@ -8,8 +8,10 @@
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <node/kernel_notifications.h>
+#include <pow.h>
 #include <script/solver.h>
 #include <primitives/block.h>
+#include <undo.h>
 #include <util/chaintype.h>
 #include <validation.h>
 
@@ -19,8 +21,11 @@
 
 using node::BLOCK_SERIALIZATION_HEADER_SIZE;
 using node::BlockManager;
+using node::BlockUndoCursor;
+using node::ImportHeaders;
 using node::KernelNotifications;
 using node::MAX_BLOCKFILE_SIZE;
+using node::WriteHeadersFile;
 
 // use BasicTestingSetup here for the data directory configuration, setup, and cleanup
 BOOST_FIXTURE_TEST_SUITE(blockmanager_tests, BasicTestingSetup)
@@ -198,4 +203,340 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
     BOOST_CHECK_EQUAL(read_block.nVersion, 2);
 }
 
+
+BOOST_AUTO_TEST_CASE(blockmanager_mmap_read)
+{
+    KernelNotifications notifications{Assert(m_node.shutdown_request), m_node.exit_status, *Assert(m_node.warnings)};
+    const BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .use_mmap = true,
+        .fast_prune = true, // Small block files, so the first one is finalized quickly
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+    };
+    BlockManager blockman{*Assert(m_node.shutdown_signal), blockman_opts};
+
+    const CBlock& genesis{Params().GenesisBlock()};
+    std::vector<FlatFilePos> positions;
+    do {
+        positions.push_back(blockman.SaveBlockToDisk(genesis, /*nHeight=*/positions.size()));
+    } while (positions.back().nFile == 0);
+
+    DataStream expected{};
+    expected << TX_WITH_WITNESS(genesis);
+
+    // Read blocks from the finalized (mapped) file and from the one that is
+    // still written to, which is read the usual way.
+    for (const FlatFilePos& pos : {positions.front(), positions[positions.size() - 2], positions.back()}) {
+        CBlock block;
+        BOOST_CHECK(blockman.ReadBlockFromDisk(block, pos));
+        BOOST_CHECK_EQUAL(block.GetHash(), genesis.GetHash());
+        std::vector<uint8_t> raw;
+        BOOST_CHECK(blockman.ReadRawBlockFromDisk(raw, pos));
+        BOOST_CHECK(std::ranges::equal(MakeByteSpan(raw), MakeByteSpan(expected)));
+    }
+
+    // The files are obfuscated, so the mapped bytes cannot be used as they are.
+    BOOST_CHECK(!blockman.GetRawBlockView(positions.front()));
+
+    // A position that does not point right after a block header is rejected.
+    CBlock block;
+    {
+        ASSERT_DEBUG_LOG("Block magic mismatch");
+        BOOST_CHECK(!blockman.ReadBlockFromDisk(block, FlatFilePos{0, positions.front().nPos + 1}));
+    }
+    {
+        ASSERT_DEBUG_LOG("Invalid position");
+        BOOST_CHECK(!blockman.ReadBlockFromDisk(block, FlatFilePos{0, std::numeric_limits<uint32_t>::max()}));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockmanager_load_block_index_guts)
+{
+    const auto params{CreateChainParams(ArgsManager{}, ChainType::REGTEST)};
+    kernel::BlockTreeDB block_tree_db{DBParams{.path = "", .cache_bytes = 1 << 20, .memory_only = true}};
+
+    // Write a chain of headers, long enough to have entries in every range
+    // the keys are split into for loading.
+    constexpr int NUM_BLOCKS{2000};
+    std::vector<uint256> hashes;
+    hashes.reserve(NUM_BLOCKS);
+    std::vector<std::unique_ptr<CBlockIndex>> blocks;
+    std::vector<const CBlockIndex*> blocks_info;
+    CBlockHeader header{params->GenesisBlock().GetBlockHeader()};
+    for (int height = 0; height < NUM_BLOCKS; ++height) {
+        if (height > 0) {
+            header.hashPrevBlock = hashes.back();
+            ++header.nTime;
+            while (!CheckProofOfWork(header.GetHash(), header.nBits, params->GetConsensus())) ++header.nNonce;
+        }
+        hashes.push_back(header.GetHash());
+        blocks.push_back(std::make_unique<CBlockIndex>(header));
+        blocks.back()->phashBlock = &hashes.back();
+        blocks.back()->nHeight = height;
+        blocks.back()->pprev = height > 0 ? blocks[height - 1].get() : nullptr;
+        blocks_info.push_back(blocks.back().get());
+    }
+    BOOST_REQUIRE(block_tree_db.WriteBatchSync({}, 0, blocks_info));
+
+    std::map<uint256, CBlockIndex> loaded;
+    const auto inserter{[&](const uint256& hash) -> CBlockIndex* {
+        if (hash.IsNull()) return nullptr;
+        const auto [it, inserted]{loaded.try_emplace(hash)};
+        if (inserted) it->second.phashBlock = &it->first;
+        return &it->second;
+    }};
+    WITH_LOCK(::cs_main, BOOST_REQUIRE(block_tree_db.LoadBlockIndexGuts(params->GetConsensus(), inserter, m_interrupt)));
+
+    BOOST_REQUIRE_EQUAL(loaded.size(), size_t{NUM_BLOCKS});
+    for (int height = 0; height < NUM_BLOCKS; ++height) {
+        const CBlockIndex& index{loaded.at(hashes[height])};
+        BOOST_CHECK_EQUAL(index.nHeight, height);
+        BOOST_CHECK_EQUAL(index.nNonce, blocks[height]->nNonce);
+        BOOST_CHECK(index.pprev == (height > 0 ? &loaded.at(hashes[height - 1]) : nullptr));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_block_indices_by_height, TestChain100Setup)
+{
+    LOCK(::cs_main);
+    BlockManager& blockman{m_node.chainman->m_blockman};
+    const std::vector<CBlockIndex*> by_height{blockman.GetAllBlockIndicesByHeight()};
+    BOOST_REQUIRE_EQUAL(by_height.size(), blockman.m_block_index.size());
+    for (size_t i = 0; i < by_height.size(); ++i) {
+        BOOST_CHECK_EQUAL(by_height[i]->nHeight, int(i));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_block_index_snapshot, TestChain100Setup)
+{
+    LOCK(::cs_main);
+    ChainstateManager& chainman{*Assert(m_node.chainman)};
+    chainman.ActiveChainstate().ForceFlushStateToDisk();
+
+    KernelNotifications notifications{Assert(m_node.shutdown_request), m_node.exit_status, *Assert(m_node.warnings)};
+    const BlockManager::Options blockman_opts{
+        .chainparams = Params(),
+        .use_index_snapshot = true,
+        .blocks_dir = m_args.GetBlocksDirPath(),
+        .notifications = notifications,
+    };
+    // Hand the block tree database from one BlockManager to the next, as if
+    // the node restarted.
+    const auto restart{[&](BlockManager& from, BlockManager& to) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+        to.m_block_tree_db = std::move(from.m_block_tree_db);
+        BOOST_REQUIRE(to.LoadBlockIndexDB(/*snapshot_blockhash=*/std::nullopt));
+    }};
+
+    // Without a snapshot, the block index is loaded from the database.
+    BlockManager first{*Assert(m_node.shutdown_signal), blockman_opts};
+    {
+        ASSERT_DEBUG_LOG("from the database");
+        restart(chainman.m_blockman, first);
+    }
+    const uint256 coins_tip{chainman.ActiveChainstate().CoinsDB().GetBestBlock()};
+    BOOST_REQUIRE(first.WriteBlockIndexSnapshot({coins_tip}));
+
+    BlockManager second{*Assert(m_node.shutdown_signal), blockman_opts};
+    {
+        ASSERT_DEBUG_LOG("from the snapshot file");
+        restart(first, second);
+    }
+    BOOST_REQUIRE_EQUAL(second.m_block_index.size(), chainman.m_blockman.m_block_index.size());
+    for (const auto& [hash, expected] : chainman.m_blockman.m_block_index) {
+        const CBlockIndex* pindex{second.LookupBlockIndex(hash)};
+        BOOST_REQUIRE(pindex);
+        BOOST_CHECK_EQUAL(pindex->nHeight, expected.nHeight);
+        BOOST_CHECK_EQUAL(pindex->nStatus, expected.nStatus);
+        BOOST_CHECK_EQUAL(pindex->nTx, expected.nTx);
+        BOOST_CHECK_EQUAL(pindex->nDataPos, expected.nDataPos);
+        BOOST_CHECK(pindex->nChainWork == expected.nChainWork);
+        BOOST_CHECK_EQUAL(pindex->GetBlockHeader().GetHash(), hash);
+        BOOST_CHECK_EQUAL(pindex->pprev ? pindex->pprev->GetBlockHash() : uint256{}, expected.pprev ? expected.pprev->GetBlockHash() : uint256{});
+    }
+    BOOST_CHECK(second.CheckIndexSnapshotCoinsTip(coins_tip));
+    BOOST_CHECK(!second.IndexSnapshotRejected());
+    BOOST_REQUIRE(second.WriteBlockIndexSnapshot({coins_tip}));
+
+    // Writing to the block tree database invalidates the snapshot.
+    BOOST_REQUIRE(second.WriteBlockIndexDB());
+    BlockManager third{*Assert(m_node.shutdown_signal), blockman_opts};
+    {
+        ASSERT_DEBUG_LOG("from the database");
+        restart(second, third);
+    }
+    BOOST_CHECK(third.CheckIndexSnapshotCoinsTip(uint256::ONE));
+
+    // Software that does not know about the snapshot may write to the
+    // database without erasing the nonce. New block file info is detected.
+    BOOST_REQUIRE(third.WriteBlockIndexSnapshot({coins_tip}));
+    uint64_t nonce;
+    BOOST_REQUIRE(third.m_block_tree_db->ReadIndexSnapshotNonce(nonce));
+    int last_file;
+    CBlockFileInfo last_file_info;
+    BOOST_REQUIRE(third.m_block_tree_db->ReadLastBlockFile(last_file));
+    BOOST_REQUIRE(third.m_block_tree_db->ReadBlockFileInfo(last_file, last_file_info));
+    ++last_file_info.nBlocks;
+    BOOST_REQUIRE(third.m_block_tree_db->WriteBatchSync({{last_file, &last_file_info}}, last_file, {}));
+    BOOST_REQUIRE(third.m_block_tree_db->WriteIndexSnapshotNonce(nonce));
+    BlockManager fourth{*Assert(m_node.shutdown_signal), blockman_opts};
+    {
+        ASSERT_DEBUG_LOG("block file info mismatch");
+        restart(third, fourth);
+    }
+
+    // So is a coins database that moved to another block.
+    BOOST_REQUIRE(fourth.WriteBlockIndexSnapshot({coins_tip}));
+    BlockManager fifth{*Assert(m_node.shutdown_signal), blockman_opts};
+    {
+        ASSERT_DEBUG_LOG("from the snapshot file");
+        restart(fourth, fifth);
+    }
+    BOOST_CHECK(!fifth.CheckIndexSnapshotCoinsTip(uint256::ONE));
+    BOOST_CHECK(fifth.IndexSnapshotRejected());
+    BOOST_CHECK(!fifth.m_block_tree_db->ReadIndexSnapshotNonce(nonce));
+    --last_file_info.nBlocks;
+    BOOST_REQUIRE(fifth.m_block_tree_db->WriteBatchSync({{last_file, &last_file_info}}, last_file, {}));
+    chainman.m_blockman.m_block_tree_db = std::move(fifth.m_block_tree_db);
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_undo_cursor, TestChain100Setup)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    BlockManager& blockman{m_node.chainman->m_blockman};
+    const CScript script_pub_key{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const auto spend{[&](const CTransactionRef& input, int input_height, CAmount amount) {
+        return CreateValidMempoolTransaction(input, /*input_vout=*/0, input_height, coinbaseKey, script_pub_key, amount, /*submit=*/false);
+    }};
+    const auto tx_a{spend(m_coinbase_txns[0], 1, 1 * COIN)};
+    const auto tx_b{spend(m_coinbase_txns[1], 2, 1 * COIN)};
+    const auto tx_child{spend(MakeTransactionRef(tx_a), 101, COIN / 2)};
+    const CBlock block{CreateAndProcessBlock({tx_a, tx_b, tx_child}, script_pub_key)};
+
+    LOCK(cs_main);
+    const CBlockIndex* tip{chainstate.m_chain.Tip()};
+    BOOST_REQUIRE_EQUAL(tip->GetBlockHash(), block.GetHash());
+
+    // The cursor hands out the same undo data as reading it in full, in any order.
+    CBlockUndo block_undo;
+    BOOST_REQUIRE(blockman.UndoReadFromDisk(block_undo, *tip));
+    const auto cursor{blockman.OpenUndoCursor(*tip)};
+    BOOST_REQUIRE(cursor);
+    BOOST_REQUIRE_EQUAL(cursor->size(), block_undo.vtxundo.size());
+    BOOST_REQUIRE_EQUAL(cursor->size(), block.vtx.size() - 1);
+    for (size_t i : {2, 0, 1, 2}) {
+        CTxUndo txundo;
+        BOOST_REQUIRE(cursor->ReadTxUndo(i, txundo));
+        const auto& expected{block_undo.vtxundo[i].vprevout};
+        BOOST_REQUIRE_EQUAL(txundo.vprevout.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            BOOST_CHECK(txundo.vprevout[j].out == expected[j].out);
+            BOOST_CHECK_EQUAL(txundo.vprevout[j].nHeight, expected[j].nHeight);
+            BOOST_CHECK_EQUAL(txundo.vprevout[j].fCoinBase, expected[j].fCoinBase);
+        }
+    }
+    CTxUndo txundo;
+    BOOST_CHECK(!cursor->ReadTxUndo(3, txundo));
+
+    // Disconnecting the block, which reads the undo data in reverse, restores
+    // the coins spent by it but not those created and spent within it.
+    CCoinsViewCache view{&chainstate.CoinsTip()};
+    BOOST_CHECK_EQUAL(chainstate.DisconnectBlock(block, tip, view), DISCONNECT_OK);
+    BOOST_CHECK(view.HaveCoin(COutPoint{m_coinbase_txns[0]->GetHash(), 0}));
+    BOOST_CHECK(view.HaveCoin(COutPoint{m_coinbase_txns[1]->GetHash(), 0}));
+    BOOST_CHECK(!view.HaveCoin(COutPoint{tx_a.GetHash(), 0}));
+    BOOST_CHECK(!view.HaveCoin(COutPoint{tx_child.GetHash(), 0}));
+
+    // A checksum mismatch is caught before any of the undo data is handed out.
+    const FlatFilePos undo_pos{tip->GetUndoPos()};
+    const fs::path rev_path{m_args.GetBlocksDirPath() / fs::u8path(strprintf("rev%05u.dat", undo_pos.nFile))};
+    const int64_t checksum_pos{undo_pos.nPos + int64_t(GetSerializeSize(block_undo))};
+    {
+        AutoFile file{fsbridge::fopen(rev_path, "rb+")};
+        BOOST_REQUIRE(!file.IsNull());
+        std::byte b;
+        file.seek(checksum_pos, SEEK_SET);
+        file >> b;
+        file.seek(checksum_pos, SEEK_SET);
+        file << std::byte(uint8_t(b) ^ 1);
+    }
+    {
+        ASSERT_DEBUG_LOG("Checksum mismatch");
+        BOOST_CHECK(!blockman.OpenUndoCursor(*tip));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_read_external_block_file, TestChain100Setup)
+{
+    LOCK(cs_main);
+    ChainstateManager& chainman{*Assert(m_node.chainman)};
+    const CChain& chain{chainman.ActiveChain()};
+
+    // All blocks of the test chain are in the first block file, in order.
+    AutoFile file{chainman.m_blockman.OpenBlockFile(FlatFilePos{0, 0}, /*fReadOnly=*/true)};
+    BOOST_REQUIRE(!file.IsNull());
+    const std::vector<ExternalBlock> blocks{ReadExternalBlockFile(file, /*file_num=*/0, chainman.GetParams(), *Assert(m_node.shutdown_signal))};
+    BOOST_REQUIRE_EQUAL(blocks.size(), size_t(chain.Height() + 1));
+    for (int height = 0; height <= chain.Height(); ++height) {
+        const ExternalBlock& external{blocks[height]};
+        BOOST_CHECK_EQUAL(external.hash, chain[height]->GetBlockHash());
+        BOOST_CHECK_EQUAL(external.block->GetHash(), external.hash);
+        BOOST_CHECK_EQUAL(external.pos.nFile, chain[height]->GetBlockPos().nFile);
+        BOOST_CHECK_EQUAL(external.pos.nPos, chain[height]->GetBlockPos().nPos);
+        // The context-independent checks have been run already.
+        BOOST_CHECK(external.block->fChecked);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockmanager_import_headers, TestChain100Setup)
+{
+    ChainstateManager& chainman{*Assert(m_node.chainman)};
+    const Consensus::Params& consensus{chainman.GetConsensus()};
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return chainman.ActiveChain().Tip())};
+
+    // Extend the tip by a few headers, without the blocks.
+    std::vector<CBlockHeader> headers;
+    CBlockHeader header{tip->GetBlockHeader()};
+    for (int i = 0; i < 10; ++i) {
+        header.hashPrevBlock = header.GetHash();
+        header.nTime += 1;
+        header.nNonce = 0;
+        while (!CheckProofOfWork(header.GetHash(), header.nBits, consensus)) ++header.nNonce;
+        headers.push_back(header);
+    }
+
+    const auto lookup{[&](const CBlockHeader& h) { return WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(h.GetHash())); }};
+    const fs::path path{m_args.GetDataDirNet() / "headers.dat"};
+
+    // A header with invalid proof of work rejects the whole file.
+    std::vector<CBlockHeader> bad_pow{headers};
+    while (CheckProofOfWork(bad_pow.back().GetHash(), bad_pow.back().nBits, consensus)) ++bad_pow.back().nNonce;
+    BOOST_REQUIRE(WriteHeadersFile(path, chainman.GetParams(), bad_pow));
+    {
+        ASSERT_DEBUG_LOG("invalid proof of work");
+        BOOST_CHECK(!ImportHeaders(chainman, path));
+    }
+    BOOST_CHECK(!lookup(headers.front()));
+
+    // So do headers that do not form a chain.
+    std::vector<CBlockHeader> unlinked{headers};
+    std::swap(unlinked[3], unlinked[4]);
+    BOOST_REQUIRE(WriteHeadersFile(path, chainman.GetParams(), unlinked));
+    {
+        ASSERT_DEBUG_LOG("do not form a chain");
+        BOOST_CHECK(!ImportHeaders(chainman, path));
+    }
+    BOOST_CHECK(!lookup(headers.front()));
+
+    BOOST_REQUIRE(WriteHeadersFile(path, chainman.GetParams(), headers));
+    BOOST_CHECK(ImportHeaders(chainman, path));
+    for (size_t i = 0; i < headers.size(); ++i) {
+        const CBlockIndex* index{lookup(headers[i])};
+        BOOST_REQUIRE(index);
+        BOOST_CHECK_EQUAL(index->nHeight, tip->nHeight + 1 + int(i));
+        BOOST_CHECK(!(index->nStatus & BLOCK_HAVE_DATA));
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainman.m_best_header->GetBlockHash()), headers.back().GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <addresstype.h>
+#include <checkqueue.h>
 #include <clientversion.h>
 #include <coins.h>
 #include <streams.h>
@@ -291,6 +292,9 @@ BOOST_FIXTURE_TEST_CASE(coins_cache_simulation_test, CacheTest)
 
     CCoinsViewDB db_base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
     SimulationTest(&db_base, true);
+
+    CCoinsViewDB async_db_base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {.async_write = true}};
+    SimulationTest(&async_db_base, true);
 }
 
 struct UpdateTest : BasicTestingSetup {
@@ -778,6 +782,34 @@ BOOST_AUTO_TEST_CASE(ccoins_add)
     }
 }
 
+static void CheckEmplaceFetchedCoin(const MaybeCoin& cache_coin, const MaybeCoin& expected)
+{
+    SingleEntryCacheTest test{VALUE1, cache_coin};
+    Coin coin;
+    SetCoinsValue(VALUE1, coin);
+    test.cache.EmplaceFetchedCoin(OUTPOINT, std::move(coin));
+    test.cache.SelfTest(/*sanity_check=*/false);
+    BOOST_CHECK_EQUAL(GetCoinsMapEntry(test.cache.map()), expected);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_emplace_fetched)
+{
+    /* Check EmplaceFetchedCoin behavior, adding a coin as it exists in the
+     * base view, and checking that only a missing entry is filled in.
+     *                      Cache               Expected
+     */
+    CheckEmplaceFetchedCoin(MISSING,            VALUE1_CLEAN      );
+
+    CheckEmplaceFetchedCoin(SPENT_CLEAN,        SPENT_CLEAN       );
+    CheckEmplaceFetchedCoin(SPENT_FRESH,        SPENT_FRESH       );
+    CheckEmplaceFetchedCoin(SPENT_DIRTY,        SPENT_DIRTY       );
+    CheckEmplaceFetchedCoin(SPENT_DIRTY_FRESH,  SPENT_DIRTY_FRESH );
+
+    CheckEmplaceFetchedCoin(VALUE2_CLEAN,       VALUE2_CLEAN      );
+    CheckEmplaceFetchedCoin(VALUE2_DIRTY,       VALUE2_DIRTY      );
+    CheckEmplaceFetchedCoin(VALUE2_DIRTY_FRESH, VALUE2_DIRTY_FRESH);
+}
+
 static void CheckWriteCoins(const MaybeCoin& parent, const MaybeCoin& child, const CoinOrError& expected)
 {
     SingleEntryCacheTest test{ABSENT, parent};
@@ -1049,6 +1081,128 @@ BOOST_FIXTURE_TEST_CASE(ccoins_flush_behavior, FlushTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_async_flush)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {.async_write = true}};
+    std::vector<COutPoint> outpoints;
+    CCoinsViewCache cache{&base};
+    for (uint32_t n{0}; n < 100; ++n) {
+        outpoints.emplace_back(Txid::FromUint256(m_rng.rand256()), n);
+        cache.AddCoin(outpoints.back(), Coin{CTxOut{n + 1, CScript{} << OP_TRUE}, 1, false}, /*possible_overwrite=*/false);
+    }
+    const uint256 first_block{m_rng.rand256()};
+    cache.SetBestBlock(first_block);
+    BOOST_CHECK(cache.Flush());
+    // The flushed coins can be looked up whether or not they have been
+    // written yet.
+    BOOST_CHECK_EQUAL(base.GetBestBlock(), first_block);
+    for (uint32_t n{0}; n < 100; ++n) {
+        BOOST_CHECK_EQUAL(cache.AccessCoin(outpoints[n]).out.nValue, n + 1);
+    }
+
+    // Spending coins while the previous flush may still be running, and
+    // flushing again, waits for it before starting the next write.
+    for (uint32_t n{0}; n < 50; ++n) {
+        BOOST_CHECK(cache.SpendCoin(outpoints[n]));
+    }
+    const uint256 second_block{m_rng.rand256()};
+    cache.SetBestBlock(second_block);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK(base.SyncPendingWrite());
+    BOOST_CHECK_EQUAL(base.PendingMemoryUsage(), 0U);
+    BOOST_CHECK_EQUAL(base.GetBestBlock(), second_block);
+    for (uint32_t n{0}; n < 100; ++n) {
+        BOOST_CHECK_EQUAL(base.HaveCoin(outpoints[n]), n >= 50);
+    }
+
+    size_t count{0};
+    for (auto cursor{base.Cursor()}; cursor->Valid(); cursor->Next()) {
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 50U);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCache writer{&base};
+        for (uint32_t n{0}; n < 100; ++n) {
+            outpoints.emplace_back(Txid::FromUint256(m_rng.rand256()), n);
+            writer.AddCoin(outpoints.back(), Coin{CTxOut{n + 1, CScript{} << OP_TRUE}, 1, false}, /*possible_overwrite=*/false);
+        }
+        writer.SetBestBlock(m_rng.rand256());
+        BOOST_CHECK(writer.Flush());
+    }
+    // An outpoint that does not exist in the base view.
+    outpoints.emplace_back(Txid::FromUint256(m_rng.rand256()), 0);
+
+    CCoinsViewCacheTest cache{&base};
+    // Entries already present in the cache must be left untouched.
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+    cache.AddCoin(outpoints[1], Coin{CTxOut{VALUE3, CScript{} << OP_TRUE}, 1, false}, /*possible_overwrite=*/true);
+
+    CoinsFetchQueue queue{/*batch_size=*/8, /*worker_threads_num=*/2};
+    cache.PrefetchCoins(outpoints, queue);
+    cache.SelfTest();
+
+    BOOST_CHECK_EQUAL(GetCoinsMapEntry(cache.map(), outpoints[0]), SPENT_DIRTY);
+    BOOST_CHECK_EQUAL(GetCoinsMapEntry(cache.map(), outpoints[1]), VALUE3_DIRTY);
+    for (uint32_t n{2}; n < 100; ++n) {
+        BOOST_CHECK_EQUAL(GetCoinsMapEntry(cache.map(), outpoints[n]), (CoinEntry{n + 1, CoinEntry::State::CLEAN}));
+    }
+    BOOST_CHECK_EQUAL(GetCoinsMapEntry(cache.map(), outpoints.back()), MISSING);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_evict_oldest)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    std::vector<COutPoint> outpoints;
+    CCoinsViewCacheTest cache{&base};
+    // Ten coins created at each of the heights 1 to 100.
+    for (uint32_t n{0}; n < 1000; ++n) {
+        outpoints.emplace_back(Txid::FromUint256(m_rng.rand256()), n);
+        cache.AddCoin(outpoints.back(), Coin{CTxOut{n + 1, CScript{} << OP_TRUE}, /*nHeightIn=*/static_cast<int>(n / 10 + 1), false}, /*possible_overwrite=*/false);
+    }
+    cache.SetBestBlock(m_rng.rand256());
+
+    // Coins that have not been written yet can not be evicted.
+    BOOST_CHECK_EQUAL(cache.GetDirtyCount(), 1000U);
+    BOOST_CHECK_EQUAL(cache.EvictOldestCoins(0), 0U);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetDirtyCount(), 0U);
+    const size_t usage{cache.DynamicMemoryUsage()};
+    BOOST_CHECK_EQUAL(cache.EvictOldestCoins(usage), 0U);
+
+    const size_t evicted{cache.EvictOldestCoins(usage / 4)};
+    cache.SelfTest();
+    BOOST_CHECK_GT(evicted, 500U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1000U - evicted);
+    BOOST_CHECK_LT(cache.DynamicMemoryUsage(), usage);
+    // Only the newest coins remain cached. Which of the coins created at the
+    // cutoff height are kept is unspecified.
+    for (uint32_t n{0}; n < 1000; ++n) {
+        if (n / 10 < evicted / 10) BOOST_CHECK(!cache.HaveCoinInCache(outpoints[n]));
+        if (n / 10 > evicted / 10) BOOST_CHECK(cache.HaveCoinInCache(outpoints[n]));
+    }
+
+    const uint64_t hits{cache.GetCacheHits()};
+    const uint64_t misses{cache.GetCacheMisses()};
+    // The evicted coins are still found in the base view.
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoints[999]).out.nValue, 1000);
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoints[0]).out.nValue, 1);
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoints[0]).out.nValue, 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheHits(), hits + 2);
+    BOOST_CHECK_EQUAL(cache.GetCacheMisses(), misses + 1);
+
+    // A limit below the share of a single coin drops the whole cache.
+    const size_t cached{cache.GetCacheSize()};
+    BOOST_CHECK_EQUAL(cache.EvictOldestCoins(1), cached);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+}
+
 BOOST_AUTO_TEST_CASE(coins_resource_is_used)
 {
     CCoinsMapMemoryResource resource;
@@ -76,6 +76,29 @@ BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
     coin_stats_index.Stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(coinstats_parallel, TestChain100Setup)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    WITH_LOCK(cs_main, chainstate.ForceFlushStateToDisk());
+    CCoinsViewDB* coins_db{WITH_LOCK(cs_main, return &chainstate.CoinsDB())};
+    // The backed view does not provide snapshot cursors, so the statistics
+    // are computed on a single thread through it, whatever the number of
+    // threads asked for.
+    CCoinsViewBacked serial_view{coins_db};
+
+    for (const auto hash_type : {kernel::CoinStatsHashType::HASH_SERIALIZED, kernel::CoinStatsHashType::MUHASH}) {
+        const auto parallel{kernel::ComputeUTXOStats(hash_type, coins_db, m_node.chainman->m_blockman, {}, /*num_threads=*/4)};
+        const auto serial{kernel::ComputeUTXOStats(hash_type, &serial_view, m_node.chainman->m_blockman, {}, /*num_threads=*/4)};
+        BOOST_REQUIRE(parallel && serial);
+        BOOST_CHECK_EQUAL(parallel->hashSerialized, serial->hashSerialized);
+        BOOST_CHECK_EQUAL(parallel->nTransactions, serial->nTransactions);
+        BOOST_CHECK_EQUAL(parallel->nTransactionOutputs, serial->nTransactionOutputs);
+        BOOST_CHECK_EQUAL(parallel->nBogoSize, serial->nBogoSize);
+        BOOST_CHECK_EQUAL(parallel->coins_count, serial->coins_count);
+        BOOST_CHECK(parallel->total_amount == serial->total_amount);
+    }
+}
+
 // Test shutdown between BlockConnected and ChainStateFlushed notifications,
 // make sure index is not corrupted and is able to reload.
 BOOST_FIXTURE_TEST_CASE(coinstatsindex_unclean_shutdown, TestChain100Setup)
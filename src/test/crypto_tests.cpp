@@ -1086,6 +1086,22 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d80)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[80 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 80 * i; ++j) {
+            in[j] = m_rng.randbits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write({in + 80 * j, 80}).Finalize({out1 + 32 * j, 32});
+        }
+        SHA256D80(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
 void CryptoTest::TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
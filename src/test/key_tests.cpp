@@ -16,6 +16,7 @@
 #include <util/string.h>
 
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -390,4 +391,34 @@ BOOST_AUTO_TEST_CASE(key_schnorr_tweak_smoke_test)
     secp256k1_context_destroy(secp256k1_context_sign);
 }
 
+BOOST_AUTO_TEST_CASE(schnorr_batch)
+{
+    SchnorrBatch batch;
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(batch.Verify());
+
+    std::vector<std::tuple<XOnlyPubKey, std::vector<unsigned char>, uint256>> checks;
+    for (int i = 0; i < 8; ++i) {
+        CKey key = GenerateRandomKey();
+        const uint256 msg{m_rng.rand256()};
+        std::vector<unsigned char> sig(64);
+        BOOST_REQUIRE(key.SignSchnorr(msg, sig, nullptr, m_rng.rand256()));
+        checks.emplace_back(XOnlyPubKey{key.GetPubKey()}, sig, msg);
+        batch.Add(XOnlyPubKey{key.GetPubKey()}, sig, msg);
+    }
+    BOOST_CHECK_EQUAL(batch.size(), checks.size());
+    BOOST_CHECK(batch.Verify());
+
+    // A single invalid signature anywhere fails the whole batch.
+    for (size_t bad = 0; bad < checks.size(); ++bad) {
+        batch.clear();
+        for (size_t i = 0; i < checks.size(); ++i) {
+            auto [pubkey, sig, msg] = checks[i];
+            if (i == bad) sig[m_rng.randrange(64)] ^= 1 << m_rng.randrange(8);
+            batch.Add(pubkey, sig, msg);
+        }
+        BOOST_CHECK(!batch.Verify());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
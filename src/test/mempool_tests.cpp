@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <common/system.h>
+#include <memusage.h>
 #include <policy/policy.h>
 #include <test/util/txmempool.h>
 #include <txmempool.h>
@@ -126,6 +127,16 @@ static void CheckSort(CTxMemPool& pool, std::vector<std::string>& sortedOrder) E
     }
 }
 
+template <>
+void CheckSort<ancestor_score>(CTxMemPool& pool, std::vector<std::string>& sortedOrder) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    BOOST_CHECK_EQUAL(pool.size(), sortedOrder.size());
+    int count = 0;
+    for (const auto& it : pool.GetSortedByAncestorScore()) {
+        BOOST_CHECK_EQUAL(it->GetTx().GetHash().ToString(), sortedOrder[count++]);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 {
     CTxMemPool& pool = *Assert(m_node.mempool);
@@ -436,6 +447,14 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     auto& pool = static_cast<MemPoolTest&>(*Assert(m_node.mempool));
     LOCK2(cs_main, pool.cs);
     TestMemPoolEntryHelper entry;
+    // Evicting transactions does not shrink the pool chunks and hash buckets
+    // of mapTx, so only take a fraction of the rest of the usage.
+    const auto usage_fraction{[&](size_t num, size_t den) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+        const size_t fixed_usage{memusage::DynamicUsage(pool.m_maptx_memory_resource) +
+                                 memusage::MallocUsage(sizeof(void*) * pool.mapTx.bucket_count()) +
+                                 memusage::MallocUsage(sizeof(void*) * pool.mapTx.get<index_by_wtxid>().bucket_count())};
+        return fixed_usage + (pool.DynamicMemoryUsage() - fixed_usage) * num / den;
+    }};
 
     CMutableTransaction tx1 = CMutableTransaction();
     tx1.vin.resize(1);
@@ -457,7 +476,7 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx1.GetHash())));
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx2.GetHash())));
 
-    pool.TrimToSize(pool.DynamicMemoryUsage() * 3 / 4); // should remove the lower-feerate transaction
+    pool.TrimToSize(usage_fraction(3, 4)); // should remove the lower-feerate transaction
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx1.GetHash())));
     BOOST_CHECK(!pool.exists(GenTxid::Txid(tx2.GetHash())));
 
@@ -471,7 +490,7 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     tx3.vout[0].nValue = 10 * COIN;
     AddToMempool(pool, entry.Fee(20000LL).FromTx(tx3));
 
-    pool.TrimToSize(pool.DynamicMemoryUsage() * 3 / 4); // tx3 should pay for tx2 (CPFP)
+    pool.TrimToSize(usage_fraction(3, 4)); // tx3 should pay for tx2 (CPFP)
     BOOST_CHECK(!pool.exists(GenTxid::Txid(tx1.GetHash())));
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx2.GetHash())));
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx3.GetHash())));
@@ -547,7 +566,7 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
         AddToMempool(pool, entry.Fee(1000LL).FromTx(tx5));
     AddToMempool(pool, entry.Fee(9000LL).FromTx(tx7));
 
-    pool.TrimToSize(pool.DynamicMemoryUsage() / 2); // should maximize mempool size by only removing 5/7
+    pool.TrimToSize(usage_fraction(1, 2)); // should maximize mempool size by only removing 5/7
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx4.GetHash())));
     BOOST_CHECK(!pool.exists(GenTxid::Txid(tx5.GetHash())));
     BOOST_CHECK(pool.exists(GenTxid::Txid(tx6.GetHash())));
@@ -600,6 +619,82 @@ inline CTransactionRef make_tx(std::vector<CAmount>&& output_values, std::vector
 }
 
 
+BOOST_AUTO_TEST_CASE(MempoolClusterTest)
+{
+    CTxMemPool::Options opts{MemPoolOptionsForTest(m_node)};
+    opts.cluster_mempool = true;
+    opts.limits.cluster_count = 3;
+    bilingual_str error;
+    CTxMemPool pool{opts, error};
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction parent = CMutableTransaction();
+    parent.vin.resize(1);
+    parent.vin[0].scriptSig = CScript() << OP_1;
+    parent.vout.resize(1);
+    parent.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    parent.vout[0].nValue = 10 * COIN;
+    AddToMempool(pool, entry.Fee(1000LL).FromTx(parent));
+
+    CMutableTransaction child = CMutableTransaction();
+    child.vin.resize(1);
+    child.vin[0].prevout = COutPoint(parent.GetHash(), 0);
+    child.vin[0].scriptSig = CScript() << OP_2;
+    child.vout.resize(1);
+    child.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+    child.vout[0].nValue = 10 * COIN;
+    AddToMempool(pool, entry.Fee(20000LL).FromTx(child));
+
+    CMutableTransaction other = CMutableTransaction();
+    other.vin.resize(1);
+    other.vin[0].scriptSig = CScript() << OP_3;
+    other.vout.resize(1);
+    other.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+    other.vout[0].nValue = 10 * COIN;
+    AddToMempool(pool, entry.Fee(5000LL).FromTx(other));
+
+    // The child pays for its parent, so they form a single chunk.
+    const auto parent_it{*pool.GetIter(parent.GetHash())};
+    const auto child_it{*pool.GetIter(child.GetHash())};
+    const auto other_it{*pool.GetIter(other.GetHash())};
+    const TxMemPoolClusters& clusters{pool.GetClusters()};
+    const FeeFrac cpfp_feerate{21000, parent_it->GetTxSize() + child_it->GetTxSize()};
+    BOOST_CHECK_EQUAL(clusters.GetChunks().size(), 2U);
+    BOOST_CHECK(clusters.GetChunkFeerate(*parent_it) == cpfp_feerate);
+    BOOST_CHECK(clusters.GetChunkFeerate(*child_it) == cpfp_feerate);
+    BOOST_CHECK(clusters.GetChunks().begin()->feerate == cpfp_feerate);
+    BOOST_CHECK_EQUAL(clusters.GetCluster(*parent_it), clusters.GetCluster(*child_it));
+    BOOST_CHECK_EQUAL(clusters.GetCluster(*parent_it)->TxCount(), 2U);
+
+    // A transaction joining both clusters would make one of 4 transactions,
+    // unless it replaces one of them.
+    CMutableTransaction merge = CMutableTransaction();
+    merge.vin.resize(2);
+    merge.vin[0].prevout = COutPoint(child.GetHash(), 0);
+    merge.vin[1].prevout = COutPoint(other.GetHash(), 0);
+    merge.vout.resize(1);
+    merge.vout[0].scriptPubKey = CScript() << OP_4 << OP_EQUAL;
+    merge.vout[0].nValue = 10 * COIN;
+    BOOST_CHECK(!pool.CheckClusterLimit({MakeTransactionRef(merge)}, {}));
+    BOOST_CHECK(pool.CheckClusterLimit({MakeTransactionRef(merge)}, {other_it}));
+    merge.vin.resize(1);
+    BOOST_CHECK(pool.CheckClusterLimit({MakeTransactionRef(merge)}, {}));
+
+    // Trimming evicts the lowest feerate chunk, even though the parent alone
+    // has a lower feerate.
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(pool.exists(GenTxid::Txid(parent.GetHash())));
+    BOOST_CHECK(pool.exists(GenTxid::Txid(child.GetHash())));
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(other.GetHash())));
+    BOOST_CHECK_EQUAL(pool.GetClusters().GetChunks().size(), 1U);
+
+    // Removing the child splits its chunk.
+    pool.removeRecursive(CTransaction(child), MemPoolRemovalReason::REPLACED);
+    BOOST_CHECK(pool.GetClusters().GetChunkFeerate(*parent_it) == FeeFrac(1000, parent_it->GetTxSize()));
+}
+
+
 BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
 {
     size_t ancestors, descendants;
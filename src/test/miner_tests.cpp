@@ -21,10 +21,12 @@
 #include <util/time.h>
 #include <util/translation.h>
 #include <validation.h>
+#include <validationinterface.h>
 #include <versionbits.h>
 
 #include <test/util/setup_common.h>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -728,4 +730,64 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     TestPrioritisedMining(scriptPubKey, txFirst);
 }
 
+BOOST_FIXTURE_TEST_CASE(block_template_cache, TestChain100Setup)
+{
+    const CScript script{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    // Make the first three coinbase outputs spendable.
+    mineBlocks(2);
+
+    CTxMemPool& mempool{*Assert(m_node.mempool)};
+    node::BlockTemplateCache cache;
+    m_node.validation_signals->RegisterValidationInterface(&cache);
+    BlockAssembler::Options options;
+    options.coinbase_output_script = script;
+    options.blockMinFeeRate = CFeeRate{1000};
+    const auto get_template{[&] {
+        m_node.validation_signals->SyncWithValidationInterfaceQueue();
+        return cache.Get(m_node.chainman->ActiveChainstate(), mempool, options);
+    }};
+    const auto in_template{[](const node::CBlockTemplate& block_template, const CMutableTransaction& tx) {
+        return std::ranges::any_of(block_template.block.vtx, [&](const auto& block_tx) { return block_tx->GetHash() == tx.GetHash(); });
+    }};
+
+    auto block_template{get_template()};
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 1U);
+
+    // A transaction below blockmintxfee leaves the template as it is, but the
+    // time of the copy handed out is refreshed.
+    const CMutableTransaction low_fee_tx{CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, script, 50 * COIN - 10)};
+    const uint32_t time{block_template->block.nTime + 60};
+    SetMockTime(time);
+    block_template = get_template();
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 1U);
+    BOOST_CHECK_EQUAL(block_template->block.nTime, time);
+
+    // A transaction that fits in the block.
+    const CMutableTransaction high_fee_tx{CreateValidMempoolTransaction(m_coinbase_txns[1], 0, 2, coinbaseKey, script, 49 * COIN)};
+    block_template = get_template();
+    BOOST_CHECK(in_template(*block_template, high_fee_tx));
+    BOOST_CHECK(!in_template(*block_template, low_fee_tx));
+
+    // Prioritisation is not notified.
+    mempool.PrioritiseTransaction(low_fee_tx.GetHash(), COIN);
+    block_template = get_template();
+    BOOST_CHECK(in_template(*block_template, high_fee_tx));
+    BOOST_CHECK(in_template(*block_template, low_fee_tx));
+
+    // Removing a transaction in the template.
+    WITH_LOCK(mempool.cs, mempool.removeRecursive(CTransaction{high_fee_tx}, MemPoolRemovalReason::CONFLICT));
+    block_template = get_template();
+    BOOST_CHECK(!in_template(*block_template, high_fee_tx));
+    BOOST_CHECK(in_template(*block_template, low_fee_tx));
+
+    // A new tip.
+    const CBlock block{CreateAndProcessBlock({}, script)};
+    block_template = get_template();
+    BOOST_CHECK_EQUAL(block_template->block.hashPrevBlock, block.GetHash());
+    BOOST_CHECK(in_template(*block_template, low_fee_tx));
+
+    m_node.validation_signals->SyncWithValidationInterfaceQueue();
+    m_node.validation_signals->UnregisterValidationInterface(&cache);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1000,6 +1000,30 @@ BOOST_AUTO_TEST_CASE(advertise_local_address)
     RemoveLocal(addr_cjdns);
 }
 
+BOOST_AUTO_TEST_CASE(v1transport_payload_view)
+{
+    // A message whose payload is a view of external bytes is sent exactly
+    // like one that owns the same payload, and releases the bytes once sent.
+    const auto payload{std::make_shared<const std::vector<unsigned char>>(m_rng.randbytes(1000))};
+    const auto send_all = [](CSerializedNetMsg msg) {
+        V1Transport transport{0};
+        BOOST_REQUIRE(transport.SetMessageToSend(msg));
+        std::vector<unsigned char> sent;
+        while (true) {
+            const auto& [bytes, _more, _msg_type] = transport.GetBytesToSend(/*have_next_message=*/false);
+            if (bytes.empty()) break;
+            sent.insert(sent.end(), bytes.begin(), bytes.end());
+            transport.MarkBytesSent(bytes.size());
+        }
+        return sent;
+    };
+
+    const auto expected{send_all(NetMsg::MakeRaw(NetMsgType::BLOCK, std::vector<unsigned char>{*payload}))};
+    BOOST_CHECK_EQUAL(expected.size(), CMessageHeader::HEADER_SIZE + payload->size());
+    BOOST_CHECK(send_all(NetMsg::MakeView(NetMsgType::BLOCK, payload, *payload)) == expected);
+    BOOST_CHECK_EQUAL(payload.use_count(), 1);
+}
+
 namespace {
 
 CKey GenerateRandomTestKey(FastRandomContext& rng) noexcept
@@ -252,6 +252,24 @@ BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
     }
 }
 
+BOOST_AUTO_TEST_CASE(streams_xor_obfuscation_key)
+{
+    // 8-byte keys are applied a word at a time; check that against applying
+    // the key byte by byte, for all lengths around the word and chunk sizes
+    // and all key offsets.
+    const auto key{m_rng.randbytes<std::byte>(8)};
+    const auto data{m_rng.randbytes<std::byte>(80)};
+    for (size_t len = 0; len <= data.size(); ++len) {
+        for (size_t key_offset = 0; key_offset < 2 * key.size(); ++key_offset) {
+            std::vector<std::byte> xored{data.begin(), data.begin() + len};
+            util::Xor(xored, key, key_offset);
+            for (size_t i = 0; i < len; ++i) {
+                BOOST_CHECK(xored[i] == (data[i] ^ key[(key_offset + i) % key.size()]));
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(streams_buffered_file)
 {
     fs::path streams_test_filename = m_args.GetDataDirBase() / "streams_test_tmp";
@@ -53,6 +53,43 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK(result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
 }
 
+/**
+ * Ensure that script failures are still reported when the scripts of a
+ * transaction are verified on the script check threads.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_parallel_script_checks, TestChain100Setup)
+{
+    BOOST_REQUIRE(m_node.chainman->GetCheckQueue().HasThreads());
+    // Make the first four coinbase outputs spendable.
+    mineBlocks(3);
+
+    std::vector<CTransactionRef> input_txs;
+    std::vector<COutPoint> inputs;
+    for (size_t i{0}; i < 4; ++i) {
+        input_txs.push_back(m_coinbase_txns[i]);
+        inputs.emplace_back(m_coinbase_txns[i]->GetHash(), 0);
+    }
+    const CScript spk{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+    const CMutableTransaction valid_tx{CreateValidMempoolTransaction(input_txs, inputs, /*input_height=*/0, {coinbaseKey},
+                                                                     {CTxOut{4 * 49 * COIN, spk}}, /*submit=*/false)};
+
+    // Use the signature of another input for one of them.
+    CMutableTransaction invalid_tx{valid_tx};
+    invalid_tx.vin[2].scriptSig = invalid_tx.vin[1].scriptSig;
+
+    LOCK(cs_main);
+
+    const MempoolAcceptResult invalid_result{m_node.chainman->ProcessTransaction(MakeTransactionRef(invalid_tx))};
+    BOOST_CHECK(invalid_result.m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(invalid_result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+    BOOST_CHECK(invalid_result.m_state.GetRejectReason().starts_with("mandatory-script-verify-flag-failed"));
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 0U);
+
+    const MempoolAcceptResult valid_result{m_node.chainman->ProcessTransaction(MakeTransactionRef(valid_tx))};
+    BOOST_CHECK(valid_result.m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 1U);
+}
+
 // Generate a number of random, nonexistent outpoints.
 static inline std::vector<COutPoint> random_outpoints(size_t num_outpoints) {
     std::vector<COutPoint> outpoints;
@@ -362,4 +362,45 @@ BOOST_AUTO_TEST_CASE(witness_commitment_index)
 
     BOOST_CHECK_EQUAL(GetWitnessCommitmentIndex(pblock), 2);
 }
+
+struct ParallelConnectSetup : public TestChain100Setup {
+    ParallelConnectSetup() : TestChain100Setup{ChainType::REGTEST, {.extra_args = {"-parconnect=2", "-coinsprefetchthreads=1"}}} {}
+};
+
+BOOST_FIXTURE_TEST_CASE(connect_block_prechecked_inputs, ParallelConnectSetup)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    BOOST_REQUIRE(m_node.chainman->GetTxPrecheckQueue().HasThreads());
+    const CScript script_pub_key{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const auto spend{[&](const CTransactionRef& input, int input_height, CAmount amount) {
+        return CreateValidMempoolTransaction(input, /*input_vout=*/0, input_height, coinbaseKey, script_pub_key, amount, /*submit=*/false);
+    }};
+
+    // Two transactions that are checked ahead of time, and one spending the
+    // output of the first, which is checked in order.
+    const auto tx_a{spend(m_coinbase_txns[0], 1, 1 * COIN)};
+    const auto tx_b{spend(m_coinbase_txns[1], 2, 1 * COIN)};
+    const auto tx_child{spend(MakeTransactionRef(tx_a), 101, COIN / 2)};
+    const CBlock block{CreateAndProcessBlock({tx_a, tx_b, tx_child}, script_pub_key)};
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainstate.m_chain.Tip()->GetBlockHash(), block.GetHash());
+        BOOST_CHECK(!chainstate.CoinsTip().HaveCoin(COutPoint{m_coinbase_txns[0]->GetHash(), 0}));
+        BOOST_CHECK(!chainstate.CoinsTip().HaveCoin(COutPoint{tx_a.GetHash(), 0}));
+        BOOST_CHECK(chainstate.CoinsTip().HaveCoin(COutPoint{tx_b.GetHash(), 0}));
+        BOOST_CHECK(chainstate.CoinsTip().HaveCoin(COutPoint{tx_child.GetHash(), 0}));
+    }
+
+    // Errors are the same as when checking in order, including for two
+    // independent transactions spending the same coin.
+    const auto check_invalid{[&](const std::vector<CMutableTransaction>& txs, const std::string& reject_reason) {
+        const CBlock invalid{CreateBlock(txs, script_pub_key, chainstate)};
+        LOCK(cs_main);
+        BlockValidationState state;
+        BOOST_CHECK(!TestBlockValidity(state, m_node.chainman->GetParams(), chainstate, invalid, chainstate.m_chain.Tip(), /*fCheckPOW=*/false));
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), reject_reason);
+    }};
+    check_invalid({spend(m_coinbase_txns[2], 3, 1 * COIN), spend(m_coinbase_txns[2], 3, 2 * COIN)}, "bad-txns-inputs-missingorspent");
+    check_invalid({spend(m_coinbase_txns[3], 4, 1 * COIN), spend(m_coinbase_txns[99], 100, 1 * COIN)}, "bad-txns-premature-spend-of-coinbase");
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 //
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <kernel/coinstats.h>
 #include <kernel/disconnected_transactions.h>
 #include <node/chainstatemanager_args.h>
 #include <node/kernel_notifications.h>
@@ -24,6 +25,7 @@
 
 #include <tinyformat.h>
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -409,6 +411,73 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, SnapshotTestSetup)
     this->SetupSnapshot();
 }
 
+//! Test that a snapshot whose coins are not in database order is hashed
+//! from the database after loading, and accepted only if that hash matches.
+BOOST_FIXTURE_TEST_CASE(chainstatemanager_snapshot_out_of_order, SnapshotTestSetup)
+{
+    ChainstateManager& chainman = *Assert(m_node.chainman);
+    mineBlocks(10);
+    const fs::path snapshot_path{m_path_root / "test_snapshot.110.dat"};
+
+    // Write the coins of each transaction back in reverse order, optionally
+    // changing the value of one of them.
+    const auto reverse_coins{[&](bool tamper) {
+        return [&, tamper](AutoFile& auto_infile, SnapshotMetadata& metadata) {
+            const int64_t coins_start{auto_infile.tell()};
+            std::vector<std::pair<Txid, std::vector<std::pair<uint64_t, Coin>>>> txs;
+            for (uint64_t coins_left{metadata.m_coins_count}; coins_left > 0;) {
+                auto& [txid, coins]{txs.emplace_back()};
+                auto_infile >> txid;
+                coins.resize(ReadCompactSize(auto_infile));
+                for (auto& [n, coin] : coins) {
+                    n = ReadCompactSize(auto_infile);
+                    auto_infile >> coin;
+                }
+                coins_left -= coins.size();
+            }
+            BOOST_REQUIRE_GT(txs.size(), 1U);
+            std::reverse(txs.begin(), txs.end());
+            if (tamper) txs.front().second.front().second.out.nValue += 1;
+
+            AutoFile outfile{fsbridge::fopen(snapshot_path, "r+b")};
+            outfile.seek(coins_start, SEEK_SET);
+            for (const auto& [txid, coins] : txs) {
+                outfile << txid;
+                WriteCompactSize(outfile, coins.size());
+                for (const auto& [n, coin] : coins) {
+                    WriteCompactSize(outfile, n);
+                    outfile << coin;
+                }
+            }
+            BOOST_REQUIRE_EQUAL(outfile.fclose(), 0);
+            auto_infile.seek(coins_start, SEEK_SET);
+        };
+    }};
+
+    {
+        ASSERT_DEBUG_LOG("coins are not in database order");
+        BOOST_REQUIRE(!CreateAndActivateUTXOSnapshot(this, reverse_coins(/*tamper=*/true)));
+    }
+    BOOST_CHECK(!chainman.IsSnapshotActive());
+
+    {
+        ASSERT_DEBUG_LOG("coins are not in database order");
+        BOOST_REQUIRE(CreateAndActivateUTXOSnapshot(this, reverse_coins(/*tamper=*/false)));
+    }
+    BOOST_CHECK(chainman.IsSnapshotActive());
+
+    // The loaded coins hash to the expected value, and the snapshot
+    // chainstate finds the coins of the reordered transactions.
+    LOCK(::cs_main);
+    Chainstate& snapshot_chainstate{chainman.ActiveChainstate()};
+    const auto stats{kernel::ComputeUTXOStats(kernel::CoinStatsHashType::HASH_SERIALIZED, &snapshot_chainstate.CoinsDB(), chainman.m_blockman)};
+    BOOST_REQUIRE(stats);
+    BOOST_CHECK(AssumeutxoHash{stats->hashSerialized} == Params().AssumeutxoForHeight(110)->hash_serialized);
+    for (const CTransactionRef& tx : m_coinbase_txns) {
+        BOOST_CHECK(snapshot_chainstate.CoinsTip().HaveCoin(COutPoint{tx->GetHash(), 0}));
+    }
+}
+
 //! Test LoadBlockIndex behavior when multiple chainstates are in use.
 //!
 //! - First, verify that setBlockIndexCandidates is as expected when using a single,
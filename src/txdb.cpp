@@ -8,10 +8,13 @@
 #include <coins.h>
 #include <dbwrapper.h>
 #include <logging.h>
+#include <memusage.h>
 #include <primitives/transaction.h>
 #include <random.h>
 #include <serialize.h>
 #include <uint256.h>
+#include <util/hasher.h>
+#include <util/threadnames.h>
 #include <util/vector.h>
 
 #include <cassert>
@@ -44,15 +47,120 @@ struct CoinEntry {
     SERIALIZE_METHODS(CoinEntry, obj) { READWRITE(obj.key, obj.outpoint->hash, VARINT(obj.outpoint->n)); }
 };
 
+/**
+ * Writes coins to the database in batches of about batch_write_bytes. The
+ * database is marked as being in transition from old_tip to best_block until
+ * the last batch is written, so that a crash in between can be recovered from
+ * by replaying the blocks.
+ */
+class CoinsBatchWriter
+{
+private:
+    CDBWrapper& m_db;
+    const CoinsViewOptions& m_options;
+    CDBBatch m_batch;
+    const uint256 m_best_block;
+
+public:
+    CoinsBatchWriter(CDBWrapper& db, const CoinsViewOptions& options, const uint256& best_block, const uint256& old_tip)
+        : m_db{db}, m_options{options}, m_batch{db}, m_best_block{best_block}
+    {
+        // In the first batch, mark the database as being in the middle of a
+        // transition from old_tip to best_block.
+        // A vector is used for future extensibility, as we may want to support
+        // interrupting after partial writes from multiple independent reorgs.
+        m_batch.Erase(DB_BEST_BLOCK);
+        m_batch.Write(DB_HEAD_BLOCKS, Vector(best_block, old_tip));
+    }
+
+    void Add(const COutPoint& outpoint, const Coin& coin)
+    {
+        CoinEntry entry(&outpoint);
+        if (coin.IsSpent()) {
+            m_batch.Erase(entry);
+        } else {
+            m_batch.Write(entry, coin);
+        }
+    }
+
+    void MaybeWritePartial()
+    {
+        if (m_batch.SizeEstimate() > m_options.batch_write_bytes) {
+            LogDebug(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", m_batch.SizeEstimate() * (1.0 / 1048576.0));
+            m_db.WriteBatch(m_batch);
+            m_batch.Clear();
+            if (m_options.simulate_crash_ratio) {
+                static FastRandomContext rng;
+                if (rng.randrange(m_options.simulate_crash_ratio) == 0) {
+                    LogPrintf("Simulating a crash. Goodbye.\n");
+                    _Exit(0);
+                }
+            }
+        }
+    }
+
+    bool Finish()
+    {
+        // In the last batch, mark the database as consistent with best_block again.
+        m_batch.Erase(DB_HEAD_BLOCKS);
+        m_batch.Write(DB_BEST_BLOCK, m_best_block);
+
+        LogDebug(BCLog::COINDB, "Writing final batch of %.2f MiB\n", m_batch.SizeEstimate() * (1.0 / 1048576.0));
+        return m_db.WriteBatch(m_batch);
+    }
+};
+
 } // namespace
 
+/** Coins passed to BatchWrite that are being written in the background. */
+struct CCoinsViewDB::PendingWrite {
+    CCoinsMapMemoryResource resource;
+    //! Spent coins are kept as well, as they have to be erased from the database.
+    CCoinsMap coins{0, SaltedOutpointHasher{/*deterministic=*/true}, CCoinsMap::key_equal{}, &resource};
+    uint256 best_block;
+    size_t usage{0};
+};
+
 CCoinsViewDB::CCoinsViewDB(DBParams db_params, CoinsViewOptions options) :
     m_db_params{std::move(db_params)},
     m_options{std::move(options)},
     m_db{std::make_unique<CDBWrapper>(m_db_params)} { }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    SyncPendingWrite();
+}
+
+void CCoinsViewDB::WaitForPendingWrite() const
+{
+    WAIT_LOCK(m_pending_mutex, lock);
+    m_pending_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_pending_mutex) { return !m_pending || m_pending_failed; });
+}
+
+bool CCoinsViewDB::SyncPendingWrite()
+{
+    if (m_write_thread.joinable()) m_write_thread.join();
+    LOCK(m_pending_mutex);
+    return !m_pending_failed;
+}
+
+size_t CCoinsViewDB::PendingMemoryUsage() const
+{
+    const auto pending{GetPendingWrite()};
+    return pending ? memusage::DynamicUsage(pending->coins) + pending->usage : 0;
+}
+
+std::shared_ptr<const CCoinsViewDB::PendingWrite> CCoinsViewDB::GetPendingWrite() const
+{
+    // Only take the lock while there is a background write, so lookups
+    // without -dbasyncflush are not slowed down by it.
+    if (!m_has_pending.load(std::memory_order_acquire)) return nullptr;
+    return WITH_LOCK(m_pending_mutex, return m_pending);
+}
+
 void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 {
+    SyncPendingWrite();
     // We can't do this operation with an in-memory DB since we'll lose all the coins upon
     // reset.
     if (!m_db_params.memory_only) {
@@ -67,15 +175,31 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 
 std::optional<Coin> CCoinsViewDB::GetCoin(const COutPoint& outpoint) const
 {
+    // Coins that are not part of a pending write have not changed, so it is
+    // fine if that write completes before they are read from the database.
+    if (const auto pending{GetPendingWrite()}) {
+        if (const auto it{pending->coins.find(outpoint)}; it != pending->coins.end()) {
+            if (it->second.coin.IsSpent()) return std::nullopt;
+            return it->second.coin;
+        }
+    }
     if (Coin coin; m_db->Read(CoinEntry(&outpoint), coin)) return coin;
     return std::nullopt;
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (const auto pending{GetPendingWrite()}) {
+        if (const auto it{pending->coins.find(outpoint)}; it != pending->coins.end()) {
+            return !it->second.coin.IsSpent();
+        }
+    }
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (const auto pending{GetPendingWrite()}) {
+        return pending->best_block;
+    }
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -91,10 +215,10 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) {
-    CDBBatch batch(*m_db);
-    size_t count = 0;
-    size_t changed = 0;
     assert(!hashBlock.IsNull());
+    // Writes are applied one after the other, so that the database is only
+    // ever in transition between two consecutive states.
+    if (!SyncPendingWrite()) return false;
 
     uint256 old_tip = GetBestBlock();
     if (old_tip.IsNull()) {
@@ -109,46 +233,84 @@ bool CCoinsViewDB::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashB
         }
     }
 
-    // In the first batch, mark the database as being in the middle of a
-    // transition from old_tip to hashBlock.
-    // A vector is used for future extensibility, as we may want to support
-    // interrupting after partial writes from multiple independent reorgs.
-    batch.Erase(DB_BEST_BLOCK);
-    batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
+    if (m_options.async_write) {
+        // Take the changed coins out of the cache, and write them after
+        // returning. Lookups see them in m_pending until they are written.
+        auto pending{std::make_shared<PendingWrite>()};
+        pending->best_block = hashBlock;
+        for (auto it{cursor.Begin()}; it != cursor.End();) {
+            if (it->second.IsDirty()) {
+                Coin& coin{pending->coins.try_emplace(it->first).first->second.coin};
+                coin = cursor.WillErase(*it) ? std::move(it->second.coin) : it->second.coin;
+                pending->usage += coin.DynamicMemoryUsage();
+            }
+            it = cursor.NextAndMaybeErase(*it);
+        }
+        {
+            LOCK(m_pending_mutex);
+            m_pending = pending;
+            m_has_pending = true;
+        }
+        m_write_thread = std::thread{[this, pending = std::move(pending), old_tip]() mutable {
+            util::ThreadRename("coinsflush");
+            bool ok{false};
+            try {
+                CoinsBatchWriter writer{*m_db, m_options, pending->best_block, old_tip};
+                for (const auto& [outpoint, entry] : pending->coins) {
+                    writer.Add(outpoint, entry.coin);
+                    writer.MaybeWritePartial();
+                }
+                ok = writer.Finish();
+                LogDebug(BCLog::COINDB, "Committed %u changed transaction outputs to coin database in the background\n", pending->coins.size());
+            } catch (const std::exception& e) {
+                LogError("%s: failed to write to coin database: %s\n", __func__, e.what());
+            }
+            {
+                LOCK(m_pending_mutex);
+                // After a failure the database may only be partially
+                // written, so keep answering lookups from the pending coins.
+                if (ok) {
+                    m_pending.reset();
+                    m_has_pending = false;
+                }
+                m_pending_failed = !ok;
+            }
+            m_pending_cv.notify_all();
+        }};
+        return true;
+    }
 
+    size_t count = 0;
+    size_t changed = 0;
+    CoinsBatchWriter writer{*m_db, m_options, hashBlock, old_tip};
     for (auto it{cursor.Begin()}; it != cursor.End();) {
         if (it->second.IsDirty()) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
-                batch.Erase(entry);
-            else
-                batch.Write(entry, it->second.coin);
+            writer.Add(it->first, it->second.coin);
             changed++;
         }
         count++;
         it = cursor.NextAndMaybeErase(*it);
+        writer.MaybeWritePartial();
+    }
+
+    bool ret = writer.Finish();
+    LogDebug(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    return ret;
+}
+
+bool CCoinsViewDB::WriteSnapshotCoins(std::span<const std::pair<COutPoint, Coin>> coins)
+{
+    if (!SyncPendingWrite()) return false;
+    CDBBatch batch{*m_db};
+    for (const auto& [outpoint, coin] : coins) {
+        batch.Write(CoinEntry(&outpoint), coin);
         if (batch.SizeEstimate() > m_options.batch_write_bytes) {
-            LogDebug(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
             batch.Clear();
-            if (m_options.simulate_crash_ratio) {
-                static FastRandomContext rng;
-                if (rng.randrange(m_options.simulate_crash_ratio) == 0) {
-                    LogPrintf("Simulating a crash. Goodbye.\n");
-                    _Exit(0);
-                }
-            }
         }
     }
-
-    // In the last batch, mark the database as consistent with hashBlock again.
-    batch.Erase(DB_HEAD_BLOCKS);
-    batch.Write(DB_BEST_BLOCK, hashBlock);
-
-    LogDebug(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-    bool ret = m_db->WriteBatch(batch);
-    LogDebug(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return ret;
+    LogDebug(BCLog::COINDB, "Wrote %u snapshot coins to coin database\n", coins.size());
+    return m_db->WriteBatch(batch);
 }
 
 size_t CCoinsViewDB::EstimateSize() const
@@ -171,8 +333,11 @@ public:
 
     bool Valid() const override;
     void Next() override;
+    bool Seek(const Txid& txid) override;
 
 private:
+    //! Keeps the database state that pcursor iterates over, if any, alive.
+    std::shared_ptr<const CDBSnapshot> m_snapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
 
@@ -181,6 +346,8 @@ private:
 
 std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
 {
+    // The cursor iterates over the database only.
+    WaitForPendingWrite();
     auto i = std::make_unique<CCoinsViewDBCursor>(
         const_cast<CDBWrapper&>(*m_db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
@@ -198,6 +365,21 @@ std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
     return i;
 }
 
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::SnapshotCursors(size_t count) const
+{
+    WaitForPendingWrite();
+    const uint256 best_block{GetBestBlock()};
+    const auto snapshot{m_db->NewSnapshot()};
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    for (size_t i = 0; i < count; ++i) {
+        auto cursor{std::make_unique<CCoinsViewDBCursor>(m_db->NewIterator(*snapshot), best_block)};
+        cursor->m_snapshot = snapshot;
+        cursor->Seek(Txid{});
+        cursors.push_back(std::move(cursor));
+    }
+    return cursors;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -218,6 +400,20 @@ bool CCoinsViewDBCursor::Valid() const
     return keyTmp.first == DB_COIN;
 }
 
+bool CCoinsViewDBCursor::Seek(const Txid& txid)
+{
+    // Keys of the coins of a transaction start with the database prefix and
+    // the txid, so this finds the first one of them.
+    pcursor->Seek(std::make_pair(DB_COIN, txid));
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+        keyTmp.first = 0;
+    } else {
+        keyTmp.first = entry.key;
+    }
+    return true;
+}
+
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
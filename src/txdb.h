@@ -12,10 +12,15 @@
 #include <sync.h>
 #include <util/fs.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <span>
+#include <thread>
+#include <utility>
 #include <vector>
 
 class COutPoint;
@@ -23,6 +28,8 @@ class uint256;
 
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -dbasyncflush default
+static constexpr bool DEFAULT_DB_ASYNC_FLUSH{false};
 
 //! User-controlled performance and debug options.
 struct CoinsViewOptions {
@@ -31,6 +38,9 @@ struct CoinsViewOptions {
     //! If non-zero, randomly exit when the database is flushed with (1/ratio)
     //! probability.
     int simulate_crash_ratio = 0;
+    //! Write the coins of a flush to the database on a background thread,
+    //! instead of before returning from BatchWrite.
+    bool async_write = DEFAULT_DB_ASYNC_FLUSH;
 };
 
 /** CCoinsView backed by the coin database (chainstate/) */
@@ -40,8 +50,27 @@ protected:
     DBParams m_db_params;
     CoinsViewOptions m_options;
     std::unique_ptr<CDBWrapper> m_db;
+
+    struct PendingWrite;
+    mutable Mutex m_pending_mutex;
+    mutable std::condition_variable m_pending_cv;
+    //! Coins handed to the background write thread that may not be in m_db
+    //! yet, which lookups have to consult first.
+    std::shared_ptr<const PendingWrite> m_pending GUARDED_BY(m_pending_mutex);
+    //! Whether the last background write failed.
+    bool m_pending_failed GUARDED_BY(m_pending_mutex){false};
+    //! Whether m_pending is set, so lookups can skip the lock when it is not.
+    std::atomic<bool> m_has_pending{false};
+    //! Only used by the thread calling BatchWrite.
+    std::thread m_write_thread;
+
+    //! Wait until m_pending has been written, or failed to be.
+    void WaitForPendingWrite() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    std::shared_ptr<const PendingWrite> GetPendingWrite() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
 public:
     explicit CCoinsViewDB(DBParams db_params, CoinsViewOptions options);
+    ~CCoinsViewDB() override;
 
     std::optional<Coin> GetCoin(const COutPoint& outpoint) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -49,6 +78,7 @@ public:
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &hashBlock) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> SnapshotCursors(size_t count) const override;
 
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
@@ -57,6 +87,27 @@ public:
     //! Dynamically alter the underlying leveldb cache size.
     void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Wait for a background write to finish, so that everything passed to
+     * BatchWrite is on disk. Returns false if that write failed, after which
+     * all further writes fail as well.
+     */
+    bool SyncPendingWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    //! Whether coins passed to BatchWrite are still being written, or failed to be.
+    bool HasPendingWrite() const { return m_has_pending.load(std::memory_order_acquire); }
+
+    //! Memory used by the coins of a background write that is still running.
+    size_t PendingMemoryUsage() const EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+    /**
+     * Write coins straight to the database, bypassing any cache, in batches
+     * of about batch_write_bytes. Used to load a UTXO snapshot into an empty
+     * database, so the best block is left alone: flush a cache with the
+     * snapshot base block as its best block once all coins are written.
+     */
+    bool WriteSnapshotCoins(std::span<const std::pair<COutPoint, Coin>> coins) EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
     //! @returns filesystem path to on-disk storage or std::nullopt if in memory.
     std::optional<fs::path> StoragePath() { return m_db->StoragePath(); }
 };
@@ -240,6 +240,49 @@ util::Result<void> CTxMemPool::CheckPackageLimits(const Package& package,
     return {};
 }
 
+util::Result<void> CTxMemPool::CheckClusterLimit(const std::vector<CTransactionRef>& txns,
+                                                  const setEntries& conflicts) const
+{
+    AssertLockHeld(cs);
+    if (!m_opts.cluster_mempool) return {};
+
+    // Conflicts and their descendants would leave their clusters.
+    setEntries removals;
+    for (txiter it : conflicts) CalculateDescendants(it, removals);
+
+    std::set<Txid> txids;
+    for (const auto& tx : txns) txids.insert(tx->GetHash());
+    const TxMemPoolClusters& clusters{GetClusters()};
+    std::set<const TxMemPoolClusters::Cluster*> merged;
+    int64_t count = txns.size();
+    for (const auto& tx : txns) {
+        for (const CTxIn& txin : tx->vin) {
+            if (txids.contains(txin.prevout.hash)) continue;
+            std::optional<txiter> parent{GetIter(txin.prevout.hash)};
+            if (!parent) continue;
+            const TxMemPoolClusters::Cluster* cluster{clusters.GetCluster(**parent)};
+            if (!cluster || !merged.insert(cluster).second) continue;
+            for (const TxMemPoolClusters::Chunk& chunk : cluster->chunks) {
+                for (const CTxMemPoolEntry* entry : chunk.txs) {
+                    if (!removals.contains(mapTx.iterator_to(*entry))) ++count;
+                }
+            }
+        }
+    }
+    if (count > m_opts.limits.cluster_count) {
+        return util::Error{Untranslated(strprintf("too many transactions in cluster [limit: %u]", m_opts.limits.cluster_count))};
+    }
+    return {};
+}
+
+const TxMemPoolClusters& CTxMemPool::GetClusters() const
+{
+    AssertLockHeld(cs);
+    Assume(m_opts.cluster_mempool);
+    m_clusters.Refresh();
+    return m_clusters;
+}
+
 util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateMemPoolAncestors(
     const CTxMemPoolEntry &entry,
     const Limits& limits,
@@ -404,6 +447,7 @@ void CTxMemPoolEntry::UpdateAncestorState(int32_t modifySize, CAmount modifyFee,
 static CTxMemPool::Options&& Flatten(CTxMemPool::Options&& opts, bilingual_str& error)
 {
     opts.check_ratio = std::clamp<int>(opts.check_ratio, 0, 1'000'000);
+    opts.limits.cluster_count = std::clamp<int64_t>(opts.limits.cluster_count, 1, MAX_CLUSTER_COUNT);
     int64_t descendant_limit_bytes = opts.limits.descendant_size_vbytes * 40;
     if (opts.max_size_bytes < 0 || opts.max_size_bytes < descendant_limit_bytes) {
         error = strprintf(_("-maxmempool must be at least %d MB"), std::ceil(descendant_limit_bytes / 1'000'000.0));
@@ -510,6 +554,8 @@ void CTxMemPool::addNewTransaction(CTxMemPool::txiter newit, CTxMemPool::setEntr
     txns_randomized.emplace_back(newit->GetSharedTx());
     newit->idx_randomized = txns_randomized.size() - 1;
 
+    if (m_opts.cluster_mempool) m_clusters.AddTransaction(entry);
+
     TRACEPOINT(mempool, added,
         entry.GetTx().GetHash().data(),
         entry.GetTxSize(),
@@ -558,6 +604,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    if (m_opts.cluster_mempool) m_clusters.RemoveTransaction(*it);
     mapTx.erase(it);
     nTransactionsUpdated++;
 }
@@ -792,6 +839,14 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
     assert(totalTxSize == checkTotal);
     assert(m_total_fee == check_total_fee);
     assert(innerUsage == cachedInnerUsage);
+
+    if (m_opts.cluster_mempool) {
+        const TxMemPoolClusters& clusters{GetClusters()};
+        size_t chunked_txs{0};
+        for (const auto& ref : clusters.GetChunks()) chunked_txs += clusters.GetChunk(ref).txs.size();
+        assert(chunked_txs == mapTx.size());
+        for (const auto& entry : mapTx) assert(clusters.GetCluster(entry) != nullptr);
+    }
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid)
@@ -844,6 +899,20 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
     return iters;
 }
 
+std::vector<CTxMemPool::txiter> CTxMemPool::GetSortedByAncestorScore() const
+{
+    AssertLockHeld(cs);
+    std::vector<txiter> iters;
+    iters.reserve(mapTx.size());
+    for (txiter it = mapTx.begin(); it != mapTx.end(); ++it) {
+        iters.push_back(it);
+    }
+    std::sort(iters.begin(), iters.end(), [](const txiter& a, const txiter& b) {
+        return CompareTxMemPoolEntryByAncestorFee()(*a, *b);
+    });
+    return iters;
+}
+
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
     return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), it->GetFee(), it->GetTxSize(), it->GetModifiedFee() - it->GetFee()};
 }
@@ -931,6 +1000,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             for (txiter descendantIt : setDescendants) {
                 mapTx.modify(descendantIt, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(0, nFeeDelta, 0, 0); });
             }
+            if (m_opts.cluster_mempool) m_clusters.UpdateTransaction(*it);
             ++nTransactionsUpdated;
         }
         if (delta == 0) {
@@ -1062,8 +1132,13 @@ void CCoinsViewMemPool::Reset()
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(txns_randomized) + cachedInnerUsage;
+    // The nodes of mapTx come from m_maptx_memory_resource, whose chunks are counted in full as for CCoinsMap. They
+    // are not released as transactions leave, but later transactions reuse their nodes. Add the bucket arrays of the
+    // hashed indexes, which are too large for the pool.
+    const size_t maptx_usage{memusage::DynamicUsage(m_maptx_memory_resource) +
+                             memusage::MallocUsage(sizeof(void*) * mapTx.bucket_count()) +
+                             memusage::MallocUsage(sizeof(void*) * mapTx.get<index_by_wtxid>().bucket_count())};
+    return maptx_usage + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(txns_randomized) + m_clusters.DynamicMemoryUsage() + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -1109,6 +1184,12 @@ void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
     } else if (!add && entry->GetMemPoolChildren().erase(*child)) {
         cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    } else {
+        return;
+    }
+    if (m_opts.cluster_mempool) {
+        m_clusters.UpdateTransaction(*entry);
+        m_clusters.UpdateTransaction(*child);
     }
 }
 
@@ -1120,6 +1201,12 @@ void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
         cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
     } else if (!add && entry->GetMemPoolParents().erase(*parent)) {
         cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    } else {
+        return;
+    }
+    if (m_opts.cluster_mempool) {
+        m_clusters.UpdateTransaction(*entry);
+        m_clusters.UpdateTransaction(*parent);
     }
 }
 
@@ -1162,19 +1249,32 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        setEntries stage;
+        CFeeRate removed;
+        if (m_opts.cluster_mempool) {
+            // Evict the lowest feerate chunk. Nothing else in its cluster
+            // depends on it, unless the cluster was too large to be
+            // linearized as a whole.
+            const TxMemPoolClusters& clusters{GetClusters()};
+            const auto& worst{*clusters.GetChunks().rbegin()};
+            removed = CFeeRate(worst.feerate.fee, worst.feerate.size);
+            for (const CTxMemPoolEntry* entry : clusters.GetChunk(worst).txs) {
+                CalculateDescendants(mapTx.iterator_to(*entry), stage);
+            }
+        } else {
+            indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+            removed = CFeeRate(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        }
 
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
         // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
         // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
         removed += m_opts.incremental_relay_feerate;
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
-        setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
@@ -1315,6 +1415,8 @@ std::optional<std::string> CTxMemPool::CheckConflictTopology(const setEntries& d
 util::Result<std::pair<std::vector<FeeFrac>, std::vector<FeeFrac>>> CTxMemPool::ChangeSet::CalculateChunksForRBF()
 {
     LOCK(m_pool->cs);
+    if (m_pool->m_opts.cluster_mempool) return CalculateClusterChunksForRBF();
+
     FeeFrac replacement_feerate{0, 0};
     for (auto it : m_entry_vec) {
         replacement_feerate += {it->GetModifiedFee(), it->GetTxSize()};
@@ -1403,6 +1505,93 @@ util::Result<std::pair<std::vector<FeeFrac>, std::vector<FeeFrac>>> CTxMemPool::
     return std::make_pair(old_chunks, new_chunks);
 }
 
+util::Result<std::pair<std::vector<FeeFrac>, std::vector<FeeFrac>>> CTxMemPool::ChangeSet::CalculateClusterChunksForRBF()
+{
+    AssertLockHeld(m_pool->cs);
+    const TxMemPoolClusters& clusters{m_pool->GetClusters()};
+
+    // The clusters affected are the ones losing transactions to the
+    // replacement, and the ones the new transactions would join.
+    std::set<const TxMemPoolClusters::Cluster*> affected;
+    for (auto it : m_to_remove) affected.insert(clusters.GetCluster(*it));
+    for (auto it : m_entry_vec) {
+        for (const CTxIn& txin : it->GetTx().vin) {
+            if (auto parent{m_pool->GetIter(txin.prevout.hash)}) affected.insert(clusters.GetCluster(**parent));
+        }
+    }
+    affected.erase(nullptr);
+
+    // OLD: the chunks of the affected clusters as they are. NEW: the chunks of
+    // a linearization of what is left of them, together with the new
+    // transactions.
+    std::vector<FeeFrac> old_chunks;
+    std::vector<const CTransaction*> txs;
+    std::vector<FeeFrac> feerates;
+    for (const TxMemPoolClusters::Cluster* cluster : affected) {
+        for (const TxMemPoolClusters::Chunk& chunk : cluster->chunks) {
+            old_chunks.push_back(chunk.feerate);
+            for (const CTxMemPoolEntry* entry : chunk.txs) {
+                if (m_to_remove.contains(m_pool->mapTx.iterator_to(*entry))) continue;
+                txs.push_back(&entry->GetTx());
+                feerates.emplace_back(entry->GetModifiedFee(), entry->GetTxSize());
+            }
+        }
+    }
+    for (auto it : m_entry_vec) {
+        txs.push_back(&it->GetTx());
+        feerates.emplace_back(it->GetModifiedFee(), it->GetTxSize());
+    }
+
+    std::map<Txid, uint32_t> indices;
+    for (uint32_t i = 0; i < txs.size(); ++i) indices.emplace(txs[i]->GetHash(), i);
+    std::vector<std::vector<uint32_t>> parents(txs.size());
+    for (uint32_t i = 0; i < txs.size(); ++i) {
+        for (const CTxIn& txin : txs[i]->vin) {
+            if (auto it{indices.find(txin.prevout.hash)}; it != indices.end()) parents[i].push_back(it->second);
+        }
+    }
+
+    // Removing the conflicts can split clusters, and the new transactions can
+    // join them, so linearize each connected component of what is left
+    // separately.
+    std::vector<uint32_t> roots(txs.size());
+    std::iota(roots.begin(), roots.end(), 0);
+    const auto find_root{[&](uint32_t i) {
+        while (roots[i] != i) i = roots[i] = roots[roots[i]];
+        return i;
+    }};
+    for (uint32_t i = 0; i < txs.size(); ++i) {
+        for (uint32_t parent : parents[i]) roots[find_root(parent)] = find_root(i);
+    }
+    std::map<uint32_t, std::vector<uint32_t>> components;
+    for (uint32_t i = 0; i < txs.size(); ++i) components[find_root(i)].push_back(i);
+
+    std::vector<FeeFrac> new_chunks;
+    FastRandomContext rng;
+    for (const auto& [_, members] : components) {
+        if (members.size() > MAX_CLUSTER_COUNT) {
+            return util::Error{Untranslated(strprintf("replacement would create a cluster of %u transactions, max %u allowed", members.size(), MAX_CLUSTER_COUNT))};
+        }
+        std::map<uint32_t, uint32_t> positions;
+        for (uint32_t pos = 0; pos < members.size(); ++pos) positions.emplace(members[pos], pos);
+        std::vector<FeeFrac> component_feerates;
+        std::vector<std::vector<uint32_t>> component_parents;
+        for (uint32_t i : members) {
+            component_feerates.push_back(feerates[i]);
+            auto& tx_parents{component_parents.emplace_back()};
+            for (uint32_t parent : parents[i]) tx_parents.push_back(positions.at(parent));
+        }
+        const auto chunks{LinearizeClusterChunks(component_feerates, component_parents, rng.rand64())};
+        new_chunks.insert(new_chunks.end(), chunks.begin(), chunks.end());
+    }
+
+    // Chunks of different clusters do not depend on each other, so the
+    // diagrams can take them in any order; sort them by feerate.
+    std::sort(old_chunks.begin(), old_chunks.end(), std::greater());
+    std::sort(new_chunks.begin(), new_chunks.end(), std::greater());
+    return std::make_pair(old_chunks, new_chunks);
+}
+
 CTxMemPool::ChangeSet::TxHandle CTxMemPool::ChangeSet::StageAddition(const CTransactionRef& tx, const CAmount fee, int64_t time, unsigned int entry_height, uint64_t entry_sequence, bool spends_coinbase, int64_t sigops_cost, LockPoints lp)
 {
     LOCK(m_pool->cs);
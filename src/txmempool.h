@@ -17,7 +17,9 @@
 #include <policy/feerate.h>
 #include <policy/packages.h>
 #include <primitives/transaction.h>
+#include <support/allocators/pool.h>
 #include <sync.h>
+#include <txmempool_clusters.h>
 #include <util/epochguard.h>
 #include <util/hasher.h>
 #include <util/result.h>
@@ -242,12 +244,18 @@ struct TxMempoolInfo
  *
  * CTxMemPool::mapTx, and CTxMemPoolEntry bookkeeping:
  *
- * mapTx is a boost::multi_index that sorts the mempool on 5 criteria:
+ * mapTx is a boost::multi_index that sorts the mempool on 4 criteria:
  * - transaction hash (txid)
  * - witness-transaction hash (wtxid)
  * - descendant feerate [we use max(feerate of tx, feerate of tx with all descendants)]
  * - time in mempool
- * - ancestor feerate [we use min(feerate of tx, feerate of tx with all unconfirmed ancestors)]
+ *
+ * Its nodes are allocated from a PoolResource owned by the mempool.
+ *
+ * The order by ancestor feerate [we use min(feerate of tx, feerate of tx with
+ * all unconfirmed ancestors)] is only needed for block assembly, so it is not
+ * kept up to date as transactions come and go; GetSortedByAncestorScore()
+ * sorts the mempool when asked.
  *
  * Note: the term "descendant" refers to in-mempool transactions that depend on
  * this one, while "ancestor" refers to in-mempool transactions that a given
@@ -319,6 +327,10 @@ protected:
     // is added or removed from the mempool for any reason.
     mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
 
+    //! Linearized clusters of the mempool, only maintained if m_opts.cluster_mempool is set.
+    //! Changes are applied lazily, when the clusters are next looked at.
+    mutable TxMemPoolClusters m_clusters GUARDED_BY(cs);
+
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     bool m_load_tried GUARDED_BY(cs){false};
@@ -349,19 +361,20 @@ public:
                 boost::multi_index::tag<entry_time>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByEntryTime
-            >,
-            // sorted by fee rate with ancestors
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<ancestor_score>,
-                boost::multi_index::identity<CTxMemPoolEntry>,
-                CompareTxMemPoolEntryByAncestorFee
             >
         >
         {};
+    /**
+     * The node size of a boost::multi_index_container is implementation defined. Two
+     * hashed indexes add up to 2 pointers each, and two ordered ones 3 each, so
+     * sizeof(void*) * 12 on top of the entry leaves room for all of them.
+     */
     typedef boost::multi_index_container<
         CTxMemPoolEntry,
-        CTxMemPoolEntry_Indices
+        CTxMemPoolEntry_Indices,
+        PoolAllocator<CTxMemPoolEntry, sizeof(CTxMemPoolEntry) + sizeof(void*) * 12>
     > indexed_transaction_set;
+    using MapTxMemoryResource = indexed_transaction_set::allocator_type::ResourceType;
 
     /**
      * This mutex needs to be locked when accessing `mapTx` or other members
@@ -388,7 +401,9 @@ public:
      * the mempool is consistent with the new chain tip and fully populated.
      */
     mutable RecursiveMutex cs;
-    indexed_transaction_set mapTx GUARDED_BY(cs);
+    //! Backs the nodes of mapTx and of the m_to_add set of changesets, so they can be moved between them.
+    MapTxMemoryResource m_maptx_memory_resource GUARDED_BY(cs);
+    indexed_transaction_set mapTx GUARDED_BY(cs){indexed_transaction_set::ctor_args_list{}, &m_maptx_memory_resource};
 
     using txiter = indexed_transaction_set::nth_index<0>::type::const_iterator;
     std::vector<CTransactionRef> txns_randomized GUARDED_BY(cs); //!< All transactions in mapTx, in random order
@@ -398,6 +413,8 @@ public:
     using Limits = kernel::MemPoolLimits;
 
     uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** All transactions, by decreasing ancestor score (see CompareTxMemPoolEntryByAncestorFee). */
+    std::vector<txiter> GetSortedByAncestorScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
@@ -582,6 +599,18 @@ public:
     util::Result<void> CheckPackageLimits(const Package& package,
                                           int64_t total_vsize) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** Check that adding the given transactions, and removing the given
+     *  conflicts and their descendants, would not make a cluster larger than
+     *  the cluster count limit. Only enforced in cluster mempool mode.
+     * @returns {} or the error reason if the limit is hit.
+     */
+    util::Result<void> CheckClusterLimit(const std::vector<CTransactionRef>& txns,
+                                         const setEntries& conflicts) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Get the linearized clusters of the mempool, bringing them up to date
+     *  first. Must only be called in cluster mempool mode. */
+    const TxMemPoolClusters& GetClusters() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Populate setDescendants with all in-mempool descendants of hash.
      *  Assumes that setDescendants includes all in-mempool descendants of anything
      *  already in it.  */
@@ -871,8 +900,11 @@ public:
         void Apply() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     private:
+        /** CalculateChunksForRBF() in cluster mempool mode, using the linearizations of the affected clusters. */
+        util::Result<std::pair<std::vector<FeeFrac>, std::vector<FeeFrac>>> CalculateClusterChunksForRBF() EXCLUSIVE_LOCKS_REQUIRED(m_pool->cs);
+
         CTxMemPool* m_pool;
-        CTxMemPool::indexed_transaction_set m_to_add;
+        CTxMemPool::indexed_transaction_set m_to_add{CTxMemPool::indexed_transaction_set::ctor_args_list{}, &m_pool->m_maptx_memory_resource};
         std::vector<CTxMemPool::txiter> m_entry_vec; // track the added transactions' insertion order
         // map from the m_to_add index to the ancestors for the transaction
         std::map<CTxMemPool::txiter, CTxMemPool::setEntries, CompareIteratorByHash> m_ancestors;
@@ -0,0 +1,188 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txmempool_clusters.h>
+
+#include <cluster_linearize.h>
+#include <kernel/mempool_entry.h>
+#include <logging.h>
+#include <memusage.h>
+#include <util/check.h>
+
+#include <algorithm>
+
+using cluster_linearize::ClusterIndex;
+using cluster_linearize::DepGraph;
+using cluster_linearize::LinearizationChunking;
+
+/** Maximum number of iterations spent on finding a good linearization for one cluster. */
+static constexpr uint64_t MAX_LINEARIZATION_ITERATIONS{10'000};
+
+size_t TxMemPoolClusters::Cluster::TxCount() const
+{
+    size_t count{0};
+    for (const Chunk& chunk : chunks) count += chunk.txs.size();
+    return count;
+}
+
+void TxMemPoolClusters::AddTransaction(const CTxMemPoolEntry& entry)
+{
+    MarkDirty(entry);
+    for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) MarkDirty(parent);
+    for (const CTxMemPoolEntry& child : entry.GetMemPoolChildrenConst()) MarkDirty(child);
+}
+
+void TxMemPoolClusters::RemoveTransaction(const CTxMemPoolEntry& entry)
+{
+    MarkDirty(entry);
+    for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) MarkDirty(parent);
+    for (const CTxMemPoolEntry& child : entry.GetMemPoolChildrenConst()) MarkDirty(child);
+    m_dirty.erase(&entry);
+}
+
+void TxMemPoolClusters::UpdateTransaction(const CTxMemPoolEntry& entry)
+{
+    MarkDirty(entry);
+}
+
+void TxMemPoolClusters::MarkDirty(const CTxMemPoolEntry& entry)
+{
+    if (auto it{m_positions.find(&entry)}; it != m_positions.end()) {
+        DissolveCluster(it->second.cluster_id);
+    }
+    m_dirty.insert(&entry);
+}
+
+size_t TxMemPoolClusters::ClusterUsage(const Cluster& cluster)
+{
+    size_t usage{memusage::DynamicUsage(cluster.chunks)};
+    for (const Chunk& chunk : cluster.chunks) usage += memusage::DynamicUsage(chunk.txs);
+    return usage;
+}
+
+void TxMemPoolClusters::DissolveCluster(uint64_t cluster_id)
+{
+    auto it{m_clusters.find(cluster_id)};
+    if (!Assume(it != m_clusters.end())) return;
+    m_cluster_usage -= ClusterUsage(it->second);
+    for (uint32_t index = 0; index < it->second.chunks.size(); ++index) {
+        const Chunk& chunk{it->second.chunks[index]};
+        m_chunk_index.erase(ChunkRef{chunk.feerate, cluster_id, index});
+        for (const CTxMemPoolEntry* tx : chunk.txs) {
+            m_positions.erase(tx);
+            m_dirty.insert(tx);
+        }
+    }
+    m_clusters.erase(it);
+}
+
+void TxMemPoolClusters::Refresh()
+{
+    while (!m_dirty.empty()) {
+        // Collect the connected component of a changed transaction. Changes
+        // dissolve the whole cluster, so the rest of it is normally dirty too,
+        // except for the other pieces of a split component.
+        const CTxMemPoolEntry* start{*m_dirty.begin()};
+        m_dirty.erase(start);
+        std::vector<const CTxMemPoolEntry*> component{start};
+        const auto visit{[&](const CTxMemPoolEntry& other) {
+            if (auto it{m_positions.find(&other)}; it != m_positions.end()) {
+                DissolveCluster(it->second.cluster_id);
+            }
+            if (m_dirty.erase(&other)) component.push_back(&other);
+        }};
+        for (size_t i = 0; i < component.size(); ++i) {
+            for (const CTxMemPoolEntry& parent : component[i]->GetMemPoolParentsConst()) visit(parent);
+            for (const CTxMemPoolEntry& child : component[i]->GetMemPoolChildrenConst()) visit(child);
+        }
+
+        // Parents have fewer ancestors than their children.
+        std::sort(component.begin(), component.end(), [](const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) {
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        });
+        if (component.size() > MAX_CLUSTER_COUNT) {
+            LogDebug(BCLog::MEMPOOL, "Splitting cluster of %u transactions for linearization\n", component.size());
+        }
+        for (size_t begin = 0; begin < component.size(); begin += MAX_CLUSTER_COUNT) {
+            const size_t end{std::min<size_t>(begin + MAX_CLUSTER_COUNT, component.size())};
+            AddCluster({component.begin() + begin, component.begin() + end});
+        }
+    }
+}
+
+void TxMemPoolClusters::AddCluster(const std::vector<const CTxMemPoolEntry*>& txs)
+{
+    Assume(!txs.empty() && txs.size() <= MAX_CLUSTER_COUNT);
+    DepGraph<SetType> depgraph;
+    std::unordered_map<const CTxMemPoolEntry*, ClusterIndex> indices;
+    for (const CTxMemPoolEntry* tx : txs) {
+        indices.emplace(tx, depgraph.AddTransaction({tx->GetModifiedFee(), tx->GetTxSize()}));
+    }
+    for (const CTxMemPoolEntry* tx : txs) {
+        SetType parents;
+        for (const CTxMemPoolEntry& parent : tx->GetMemPoolParentsConst()) {
+            if (auto it{indices.find(&parent)}; it != indices.end()) parents.Set(it->second);
+        }
+        if (parents.Any()) depgraph.AddDependencies(parents, indices.at(tx));
+    }
+    auto linearization{Linearize(depgraph, MAX_LINEARIZATION_ITERATIONS, m_rng.rand64()).first};
+    PostLinearize(depgraph, linearization);
+
+    const uint64_t cluster_id{m_next_cluster_id++};
+    Cluster& cluster{m_clusters[cluster_id]};
+    LinearizationChunking chunking{depgraph, linearization};
+    cluster.chunks.resize(chunking.NumChunksLeft());
+    for (uint32_t index = 0; index < cluster.chunks.size(); ++index) {
+        const auto& chunk_info{chunking.GetChunk(index)};
+        Chunk& chunk{cluster.chunks[index]};
+        chunk.feerate = chunk_info.feerate;
+        for (ClusterIndex i : linearization) {
+            if (!chunk_info.transactions[i]) continue;
+            chunk.txs.push_back(txs[i]);
+            m_positions[txs[i]] = Position{cluster_id, index};
+        }
+        m_chunk_index.insert(ChunkRef{chunk.feerate, cluster_id, index});
+    }
+    m_cluster_usage += ClusterUsage(cluster);
+}
+
+const TxMemPoolClusters::Cluster* TxMemPoolClusters::GetCluster(const CTxMemPoolEntry& entry) const
+{
+    auto it{m_positions.find(&entry)};
+    return it == m_positions.end() ? nullptr : GetCluster(it->second.cluster_id);
+}
+
+const TxMemPoolClusters::Cluster* TxMemPoolClusters::GetCluster(uint64_t cluster_id) const
+{
+    auto it{m_clusters.find(cluster_id)};
+    return it == m_clusters.end() ? nullptr : &it->second;
+}
+
+std::optional<FeeFrac> TxMemPoolClusters::GetChunkFeerate(const CTxMemPoolEntry& entry) const
+{
+    auto it{m_positions.find(&entry)};
+    if (it == m_positions.end()) return std::nullopt;
+    return m_clusters.at(it->second.cluster_id).chunks.at(it->second.chunk).feerate;
+}
+
+size_t TxMemPoolClusters::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(m_clusters) + memusage::DynamicUsage(m_positions) +
+           memusage::DynamicUsage(m_dirty) + memusage::DynamicUsage(m_chunk_index) + m_cluster_usage;
+}
+
+std::vector<FeeFrac> LinearizeClusterChunks(const std::vector<FeeFrac>& feerates, const std::vector<std::vector<uint32_t>>& parents, uint64_t rng_seed)
+{
+    Assume(feerates.size() == parents.size() && feerates.size() <= MAX_CLUSTER_COUNT);
+    DepGraph<TxMemPoolClusters::SetType> depgraph;
+    for (const FeeFrac& feerate : feerates) depgraph.AddTransaction(feerate);
+    for (ClusterIndex i = 0; i < parents.size(); ++i) {
+        TxMemPoolClusters::SetType parent_set;
+        for (uint32_t parent : parents[i]) parent_set.Set(parent);
+        if (parent_set.Any()) depgraph.AddDependencies(parent_set, i);
+    }
+    auto linearization{Linearize(depgraph, MAX_LINEARIZATION_ITERATIONS, rng_seed).first};
+    PostLinearize(depgraph, linearization);
+    return ChunkLinearization(depgraph, linearization);
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2024-present The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXMEMPOOL_CLUSTERS_H
+#define BITCOIN_TXMEMPOOL_CLUSTERS_H
+
+#include <random.h>
+#include <util/bitset.h>
+#include <util/feefrac.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class CTxMemPoolEntry;
+
+/** Maximum number of transactions in a cluster that TxMemPoolClusters linearizes as a whole. */
+static constexpr unsigned int MAX_CLUSTER_COUNT{64};
+
+/**
+ * Tracks the clusters (connected components of the dependency graph) of a
+ * mempool, and keeps a linearization of each of them, split into chunks.
+ *
+ * Entries are referred to by pointer, which is stable for as long as they are
+ * in the mempool. Any change to an entry (added, removed, its fee modified or
+ * its links to parents and children changed) must be reported, which
+ * dissolves its cluster. Dissolved clusters are rebuilt from the mempool links
+ * and relinearized on the next call to Refresh(), so the work per change is
+ * bounded by the size of the clusters it touches.
+ *
+ * Chunks of all clusters are indexed by feerate. Within a cluster, chunks have
+ * non-increasing feerates and each chunk only depends on the ones before it,
+ * so walking the index from the highest feerate down visits every cluster's
+ * chunks in a valid order, and its lowest feerate chunk has no descendants in
+ * its cluster.
+ *
+ * Connected components with more than MAX_CLUSTER_COUNT transactions (which
+ * the admission limits should prevent, but reorgs can produce) are split in
+ * topological order into pieces that are linearized separately. Chunks of
+ * such pieces may depend on transactions in earlier pieces, so users must
+ * check that the parents of a chunk are included before it.
+ */
+class TxMemPoolClusters
+{
+public:
+    using SetType = BitSet<MAX_CLUSTER_COUNT>;
+
+    /** A chunk of a cluster's linearization. */
+    struct Chunk {
+        FeeFrac feerate;
+        /** Transactions in the chunk, in linearization order. */
+        std::vector<const CTxMemPoolEntry*> txs;
+    };
+
+    /** A linearized cluster. */
+    struct Cluster {
+        /** Chunks of the linearization, in order. */
+        std::vector<Chunk> chunks;
+        size_t TxCount() const;
+    };
+
+    /** Position of a chunk in the feerate index. */
+    struct ChunkRef {
+        FeeFrac feerate;
+        uint64_t cluster_id;
+        uint32_t index;
+    };
+
+    /** Orders chunks by decreasing feerate, keeping the order of chunks within a cluster. */
+    struct CompareChunkRef {
+        bool operator()(const ChunkRef& a, const ChunkRef& b) const
+        {
+            if (auto cmp{FeeRateCompare(a.feerate, b.feerate)}; cmp != 0) return cmp > 0;
+            if (a.cluster_id != b.cluster_id) return a.cluster_id < b.cluster_id;
+            return a.index < b.index;
+        }
+    };
+
+    using ChunkIndex = std::set<ChunkRef, CompareChunkRef>;
+
+    /** Report a transaction that was added to the mempool, after its links to parents are set. */
+    void AddTransaction(const CTxMemPoolEntry& entry);
+    /** Report a transaction that is about to be removed from the mempool. */
+    void RemoveTransaction(const CTxMemPoolEntry& entry);
+    /** Report a change to the fee or the links of a transaction in the mempool. */
+    void UpdateTransaction(const CTxMemPoolEntry& entry);
+
+    /** Rebuild and relinearize all clusters that were dissolved since the last call. */
+    void Refresh();
+
+    /** Get the cluster of a transaction, or nullptr if it was changed since the last Refresh(). */
+    const Cluster* GetCluster(const CTxMemPoolEntry& entry) const;
+    /** Get the cluster with the given id, or nullptr. */
+    const Cluster* GetCluster(uint64_t cluster_id) const;
+    /** Get the feerate of the chunk of a transaction, or nullopt if it was changed since the last Refresh(). */
+    std::optional<FeeFrac> GetChunkFeerate(const CTxMemPoolEntry& entry) const;
+    /** Get the chunks of all clusters, by decreasing feerate. */
+    const ChunkIndex& GetChunks() const { return m_chunk_index; }
+    /** Get a chunk from the index. */
+    const Chunk& GetChunk(const ChunkRef& ref) const { return m_clusters.at(ref.cluster_id).chunks.at(ref.index); }
+
+    /** Whether all changes have been processed by Refresh(). */
+    bool IsUpToDate() const { return m_dirty.empty(); }
+    size_t DynamicMemoryUsage() const;
+
+private:
+    /** Position of a transaction in a cluster. */
+    struct Position {
+        uint64_t cluster_id;
+        uint32_t chunk;
+    };
+
+    /** Dissolve the cluster of an entry, if any, and mark the entry to be rebuilt. */
+    void MarkDirty(const CTxMemPoolEntry& entry);
+    void DissolveCluster(uint64_t cluster_id);
+    /** Linearize a set of connected transactions, given in topological order, as a new cluster. */
+    void AddCluster(const std::vector<const CTxMemPoolEntry*>& txs);
+    /** Memory used by the chunks of a cluster, which is fixed once it is added. */
+    static size_t ClusterUsage(const Cluster& cluster);
+
+    std::map<uint64_t, Cluster> m_clusters;
+    std::unordered_map<const CTxMemPoolEntry*, Position> m_positions;
+    std::set<const CTxMemPoolEntry*> m_dirty;
+    ChunkIndex m_chunk_index;
+    /** Sum of ClusterUsage() over m_clusters, so DynamicMemoryUsage() does not walk them. */
+    size_t m_cluster_usage{0};
+    uint64_t m_next_cluster_id{0};
+    FastRandomContext m_rng;
+};
+
+/** Linearize a dependency graph and return the feerates of the chunks, in order. */
+std::vector<FeeFrac> LinearizeClusterChunks(const std::vector<FeeFrac>& feerates, const std::vector<std::vector<uint32_t>>& parents, uint64_t rng_seed);
+
+#endif // BITCOIN_TXMEMPOOL_CLUSTERS_H
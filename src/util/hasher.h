@@ -81,8 +81,9 @@ struct BlockHasher
 {
     // this used to call `GetCheapHash()` in uint256, which was later moved; the
     // cheap hash function simply calls ReadLE64() however, so the end result is
-    // identical
-    size_t operator()(const uint256& hash) const { return ReadLE64(hash.begin()); }
+    // identical. Being cheap and noexcept, std::unordered_map does not need to
+    // cache it in every node.
+    size_t operator()(const uint256& hash) const noexcept { return ReadLE64(hash.begin()); }
 };
 
 class SaltedSipHasher
@@ -59,6 +59,7 @@
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/threadnames.h>
 #include <util/time.h>
 #include <util/trace.h>
 #include <util/translation.h>
@@ -68,12 +69,14 @@
 #include <cassert>
 #include <chrono>
 #include <deque>
+#include <future>
 #include <numeric>
 #include <optional>
 #include <ranges>
 #include <span>
 #include <string>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 
 using kernel::CCoinsStats;
@@ -110,6 +113,9 @@ const std::vector<std::string> CHECKLEVEL_DOC {
  *  noticeably interfere with the pruning mechanism.
  * */
 static constexpr int PRUNE_LOCK_BUFFER{10};
+/** Minimum number of script checks for which mempool acceptance hands them to
+ *  the script check threads. Fewer are cheaper to run on the calling thread. */
+static constexpr size_t MIN_PARALLEL_POLICY_SCRIPT_CHECKS{4};
 
 TRACEPOINT_SEMAPHORE(validation, block_connected);
 TRACEPOINT_SEMAPHORE(utxocache, flush);
@@ -683,6 +689,14 @@ private:
     // only invoke this on transactions that have otherwise passed policy checks.
     bool PolicyScriptChecks(const ATMPArgs& args, Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
 
+    // Run the script checks of the given transactions using our policy flags on the
+    // script check threads. Returns true if they all passed. Failures are not reported:
+    // PolicyScriptChecks() must then be used to find the failing transaction and fill
+    // in its state. That serial re-run stays cheap, as the valid signatures verified
+    // here are stored in the signature cache. Also returns false if there are no
+    // script check threads, or too few checks to be worth handing to them.
+    bool ParallelPolicyScriptChecks(std::span<Workspace> workspaces) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
     // Re-run the script checks, using consensus flags, and try to cache the
     // result in the scriptcache. This should be done after
     // PolicyScriptChecks(). This requires that all inputs either be in our
@@ -1048,6 +1062,12 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
         }
     }
 
+    // In cluster mode, the cluster the transaction would join (minus what it
+    // replaces) has to remain small enough to be linearized.
+    if (auto result{m_pool.CheckClusterLimit({ws.m_ptx}, ws.m_iters_conflicting)}; !result) {
+        return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "too-large-cluster", util::ErrorString(result).original);
+    }
+
     // A transaction that spends outputs that would be replaced by it is invalid. Now
     // that we have the set of all ancestors we can detect this
     // pathological case by making sure ws.m_conflicts and ws.m_ancestors don't
@@ -1144,6 +1164,14 @@ bool MemPoolAccept::PackageMempoolChecks(const std::vector<CTransactionRef>& txn
         return package_state.Invalid(PackageValidationResult::PCKG_POLICY, "package-mempool-limits", util::ErrorString(result).original);
     }
 
+    CTxMemPool::setEntries package_conflicts;
+    for (const Workspace& ws : workspaces) {
+        package_conflicts.insert(ws.m_iters_conflicting.begin(), ws.m_iters_conflicting.end());
+    }
+    if (auto cluster_result{m_pool.CheckClusterLimit(txns, package_conflicts)}; !cluster_result) {
+        return package_state.Invalid(PackageValidationResult::PCKG_POLICY, "package-mempool-limits", util::ErrorString(cluster_result).original);
+    }
+
     // No conflicts means we're finished. Further checks are all RBF-only.
     if (!m_subpackage.m_rbf) return true;
 
@@ -1252,6 +1280,34 @@ bool MemPoolAccept::PolicyScriptChecks(const ATMPArgs& args, Workspace& ws)
     return true;
 }
 
+bool MemPoolAccept::ParallelPolicyScriptChecks(std::span<Workspace> workspaces)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+    CCheckQueue<CScriptCheck>& queue{m_active_chainstate.m_chainman.GetCheckQueue()};
+    if (!queue.HasThreads()) return false;
+
+    // Only collect the checks here; transactions found in the script
+    // execution cache add none.
+    std::vector<CScriptCheck> checks;
+    for (Workspace& ws : workspaces) {
+        TxValidationState state_dummy;
+        if (!CheckInputScripts(*ws.m_ptx, state_dummy, m_view, STANDARD_SCRIPT_VERIFY_FLAGS, true, false,
+                               ws.m_precomputed_txdata, GetValidationCache(), &checks)) {
+            return false;
+        }
+    }
+    if (checks.size() < MIN_PARALLEL_POLICY_SCRIPT_CHECKS) return false;
+
+    // The queue is shared with block validation. ConnectBlock() holds cs_main
+    // for as long as its CCheckQueueControl exists, and mempool acceptance is
+    // never reached from within it, so holding cs_main here means the queue is
+    // neither in use by another thread nor already controlled by this one.
+    CCheckQueueControl<CScriptCheck> control(&queue);
+    control.Add(std::move(checks));
+    return !control.Complete().has_value();
+}
+
 bool MemPoolAccept::ConsensusScriptChecks(const ATMPArgs& args, Workspace& ws)
 {
     AssertLockHeld(cs_main);
@@ -1454,7 +1510,9 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     // Perform the inexpensive checks first and avoid hashing and signature verification unless
     // those checks pass, to mitigate CPU exhaustion denial-of-service attacks.
-    if (!PolicyScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
+    if (!ParallelPolicyScriptChecks({&ws, 1}) && !PolicyScriptChecks(args, ws)) {
+        return MempoolAcceptResult::Failure(ws.m_state);
+    }
 
     if (!ConsensusScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
@@ -1600,9 +1658,12 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptMultipleTransactions(const std::
         }
     }
 
+    // Verify the scripts of the whole package at once. If any of them fails, check
+    // the transactions one at a time to report the first failure.
+    const bool scripts_passed{ParallelPolicyScriptChecks(workspaces)};
     for (Workspace& ws : workspaces) {
         ws.m_package_feerate = package_feerate;
-        if (!PolicyScriptChecks(args, ws)) {
+        if (!scripts_passed && !PolicyScriptChecks(args, ws)) {
             // Exit early to avoid doing pointless work. Update the failed tx result; the rest are unfinished.
             package_state.Invalid(PackageValidationResult::PCKG_TX, "transaction failed");
             results.emplace(ws.m_ptx->GetWitnessHash(), MempoolAcceptResult::Failure(ws.m_state));
@@ -2113,11 +2174,11 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
     AddCoins(inputs, tx, nHeight);
 }
 
-std::optional<std::pair<ScriptError, std::string>> CScriptCheck::operator()() {
+std::optional<std::pair<ScriptError, std::string>> CScriptCheck::Check(DeferredSchnorrChecks* deferred) {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
     ScriptError error{SCRIPT_ERR_UNKNOWN_ERROR};
-    if (VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *m_signature_cache, *txdata), &error)) {
+    if (VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *m_signature_cache, *txdata, deferred), &error)) {
         return std::nullopt;
     } else {
         auto debug_str = strprintf("input %i of %s (wtxid %s), spending %s:%i", nIn, ptxTo->GetHash().ToString(), ptxTo->GetWitnessHash().ToString(), ptxTo->vin[nIn].prevout.hash.ToString(), ptxTo->vin[nIn].prevout.n);
@@ -2125,6 +2186,23 @@ std::optional<std::pair<ScriptError, std::string>> CScriptCheck::operator()() {
     }
 }
 
+std::optional<std::pair<ScriptError, std::string>> CScriptCheck::BatchCheck(std::span<CScriptCheck> checks)
+{
+    if (SchnorrBatch::IS_BATCHED && checks.size() > 1) {
+        // A valid non-empty Schnorr signature never changes the course of
+        // script execution, so assuming the deferred ones are valid is
+        // harmless as long as the batch is verified before returning.
+        DeferredSchnorrChecks deferred;
+        const bool scripts_ok{std::ranges::all_of(checks, [&](CScriptCheck& check) { return !check.Check(&deferred).has_value(); })};
+        if (scripts_ok && deferred.Verify()) return std::nullopt;
+    }
+    // Find the first failing check and its error.
+    for (CScriptCheck& check : checks) {
+        if (auto result = check(); result.has_value()) return result;
+    }
+    return std::nullopt;
+}
+
 ValidationCache::ValidationCache(const size_t script_execution_cache_bytes, const size_t signature_cache_bytes)
     : m_signature_cache{signature_cache_bytes}
 {
@@ -2252,6 +2330,50 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     return true;
 }
 
+std::optional<std::string> TxInputsPrecheck::operator()()
+{
+    const CTransaction& tx{*m_tx};
+    std::vector<Coin> spent_coins;
+    spent_coins.reserve(tx.vin.size());
+    try {
+        for (const CTxIn& txin : tx.vin) {
+            auto coin{m_view->PeekCoin(txin.prevout)};
+            if (!coin) return "inputs missing/spent";
+            spent_coins.push_back(std::move(*coin));
+        }
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+
+    TxValidationState tx_state;
+    CAmount fee{0};
+    if (!Consensus::CheckTxInputs(tx, tx_state, spent_coins, m_block->nHeight, fee)) {
+        return tx_state.ToString();
+    }
+
+    std::vector<int> prevheights;
+    prevheights.reserve(tx.vin.size());
+    for (const Coin& coin : spent_coins) {
+        prevheights.push_back(coin.nHeight);
+    }
+    if (!SequenceLocks(tx, m_lock_time_flags, prevheights, *m_block)) {
+        return "non-BIP68-final";
+    }
+
+    m_result->sigops_cost = GetTransactionSigOpCost(tx, spent_coins, m_script_flags);
+    if (m_txdata) {
+        std::vector<CTxOut> spent_outputs;
+        spent_outputs.reserve(spent_coins.size());
+        for (Coin& coin : spent_coins) {
+            spent_outputs.push_back(std::move(coin.out));
+        }
+        m_txdata->Init(tx, std::move(spent_outputs));
+    }
+    m_result->fee = fee;
+    m_result->ok = true;
+    return std::nullopt;
+}
+
 bool FatalError(Notifications& notifications, BlockValidationState& state, const bilingual_str& message)
 {
     notifications.fatalError(message);
@@ -2300,13 +2422,15 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
     AssertLockHeld(::cs_main);
     bool fClean = true;
 
-    CBlockUndo blockUndo;
-    if (!m_blockman.UndoReadFromDisk(blockUndo, *pindex)) {
+    // Read the undo data one transaction at a time, rather than the whole
+    // CBlockUndo at once, to bound memory usage.
+    const auto undo_cursor{m_blockman.OpenUndoCursor(*pindex)};
+    if (!undo_cursor) {
         LogError("DisconnectBlock(): failure reading undo data\n");
         return DISCONNECT_FAILED;
     }
 
-    if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+    if (undo_cursor->size() + 1 != block.vtx.size()) {
         LogError("DisconnectBlock(): block and undo data inconsistent\n");
         return DISCONNECT_FAILED;
     }
@@ -2321,6 +2445,7 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
                            (pindex->nHeight==2021 && pindex->GetBlockHash() == uint256{"00000002002ebe1b2bf4610daf00450280bb3a3262623d3b6fe14966cbd8a425"}));
 
     // undo transactions in reverse order
+    CTxUndo txundo;
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         Txid hash = tx.GetHash();
@@ -2344,7 +2469,10 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
 
         // restore inputs
         if (i > 0) { // not coinbases
-            CTxUndo &txundo = blockUndo.vtxundo[i-1];
+            if (!undo_cursor->ReadTxUndo(i - 1, txundo)) {
+                LogError("DisconnectBlock(): failure reading undo data\n");
+                return DISCONNECT_FAILED;
+            }
             if (txundo.vprevout.size() != tx.vin.size()) {
                 LogError("DisconnectBlock(): transaction and undo data inconsistent\n");
                 return DISCONNECT_FAILED;
@@ -2434,6 +2562,44 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex& block_index, const Ch
 }
 
 
+/**
+ * Run TxInputsPrecheck on the queue for every transaction of the block that
+ * does not spend an output created in the block. Nothing may modify the view
+ * until this returns.
+ *
+ * @param[in] txsdata If set, the precomputed data of every transaction whose
+ *                    checks passed is initialized.
+ * @returns the result for every transaction of the block, by index
+ */
+static std::vector<TxInputsPrecheck::Result> PrecheckBlockInputs(CCheckQueue<TxInputsPrecheck>& queue, const CBlock& block, const CCoinsView& view,
+                                                                 const CBlockIndex& block_index, int lock_time_flags, unsigned int script_flags,
+                                                                 std::vector<PrecomputedTransactionData>* txsdata)
+{
+    std::vector<TxInputsPrecheck::Result> results(block.vtx.size());
+    std::unordered_set<Txid, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+
+    std::vector<TxInputsPrecheck> jobs;
+    jobs.reserve(block.vtx.size());
+    for (size_t i{1}; i < block.vtx.size(); ++i) {
+        const CTransaction& tx{*block.vtx[i]};
+        const bool dependent{std::any_of(tx.vin.begin(), tx.vin.end(), [&](const CTxIn& txin) { return block_txids.contains(txin.prevout.hash); })};
+        if (dependent) continue;
+        jobs.emplace_back(tx, view, block_index, lock_time_flags, script_flags, txsdata ? &(*txsdata)[i] : nullptr, results[i]);
+    }
+    if (jobs.empty()) return results;
+
+    CCheckQueueControl<TxInputsPrecheck> control(&queue);
+    control.Add(std::move(jobs));
+    // A failed check only means that the transaction is checked again while
+    // connecting the block, which reports the error.
+    (void)control.Complete();
+    return results;
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
@@ -2638,6 +2804,19 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && parallel_script_checks ? &m_chainman.GetCheckQueue() : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
 
+    // With -parconnect, check the inputs of the transactions that do not
+    // spend outputs created in this block on worker threads first. Their
+    // results are used in block order below. A transaction whose checks
+    // failed, or whose inputs were spent by an earlier transaction of the
+    // block, is checked as usual, so that the outcome and the reported error
+    // are the same either way.
+    std::vector<TxInputsPrecheck::Result> prechecks;
+    if (m_chainman.GetTxPrecheckQueue().HasThreads()) {
+        prechecks = PrecheckBlockInputs(m_chainman.GetTxPrecheckQueue(), block, view, *pindex, nLockTimeFlags, flags, fScriptChecks ? &txsdata : nullptr);
+        const auto time_precheck{SteadyClock::now()};
+        LogDebug(BCLog::BENCH, "    - Precheck inputs: %.2fms\n", Ticks<MillisecondsDouble>(time_precheck - time_2));
+    }
+
     std::vector<int> prevheights;
     CAmount nFees = 0;
     int nInputs = 0;
@@ -2650,11 +2829,14 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
 
         nInputs += tx.vin.size();
 
+        const bool prechecked{!prechecks.empty() && prechecks[i].ok && view.HaveInputs(tx)};
         if (!tx.IsCoinBase())
         {
             CAmount txfee = 0;
             TxValidationState tx_state;
-            if (!Consensus::CheckTxInputs(tx, tx_state, view, pindex->nHeight, txfee)) {
+            if (prechecked) {
+                txfee = prechecks[i].fee;
+            } else if (!Consensus::CheckTxInputs(tx, tx_state, view, pindex->nHeight, txfee)) {
                 // Any transaction validation failure in ConnectBlock is a block consensus failure
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS,
                               tx_state.GetRejectReason(),
@@ -2671,15 +2853,17 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             // Check that transaction is BIP68 final
             // BIP68 lock checks (as opposed to nLockTime checks) must
             // be in ConnectBlock because they require the UTXO set
-            prevheights.resize(tx.vin.size());
-            for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
-            }
+            if (!prechecked) {
+                prevheights.resize(tx.vin.size());
+                for (size_t j = 0; j < tx.vin.size(); j++) {
+                    prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
+                }
 
-            if (!SequenceLocks(tx, nLockTimeFlags, prevheights, *pindex)) {
-                state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal",
-                              "contains a non-BIP68-final transaction " + tx.GetHash().ToString());
-                break;
+                if (!SequenceLocks(tx, nLockTimeFlags, prevheights, *pindex)) {
+                    state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-txns-nonfinal",
+                                  "contains a non-BIP68-final transaction " + tx.GetHash().ToString());
+                    break;
+                }
             }
         }
 
@@ -2687,7 +2871,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         // * legacy (always)
         // * p2sh (when P2SH enabled in flags and excludes coinbase)
         // * witness (when witness enabled in flags and excludes coinbase)
-        nSigOpsCost += GetTransactionSigOpCost(tx, view, flags);
+        nSigOpsCost += prechecked ? prechecks[i].sigops_cost : GetTransactionSigOpCost(tx, view, flags);
         if (nSigOpsCost > MAX_BLOCK_SIGOPS_COST) {
             state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-sigops", "too many sigops");
             break;
@@ -2799,7 +2983,9 @@ CoinsCacheSizeState Chainstate::GetCoinsCacheSizeState(
 {
     AssertLockHeld(::cs_main);
     const int64_t nMempoolUsage = m_mempool ? m_mempool->DynamicMemoryUsage() : 0;
-    int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
+    // Coins that are still being written to the database in the background
+    // count towards the cache size until they are on disk.
+    int64_t cacheSize = CoinsTip().DynamicMemoryUsage() + CoinsDB().PendingMemoryUsage();
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(int64_t(max_mempool_size_bytes) - nMempoolUsage, 0);
 
@@ -2925,6 +3111,11 @@ bool Chainstate::FlushStateToDisk(
             if (fFlushForPrune) {
                 LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
 
+                // A background write of an earlier flush must be on disk
+                // before the blocks it would be replayed from are removed.
+                if (!CoinsDB().SyncPendingWrite()) {
+                    return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+                }
                 m_blockman.UnlinkPrunedFiles(setFilesToPrune);
             }
             m_last_write = nNow;
@@ -2945,9 +3136,35 @@ bool Chainstate::FlushStateToDisk(
             }
             // Flush the chainstate (which may refer to block index entries).
             const auto empty_cache{(mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical};
-            if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
+            // When the cache is only being written because it is full, write
+            // every modified coin (the database must match a single best
+            // block) but keep the newest coins cached, so the blocks that
+            // follow do not start out on an empty cache.
+            const int retain_percent{m_chainman.m_options.coins_cache_retain_percent};
+            const bool partial_flush{empty_cache && mode != FlushStateMode::ALWAYS && retain_percent > 0};
+            const size_t coins_dirty{CoinsTip().GetDirtyCount()};
+            size_t coins_evicted{0};
+            const auto coins_flush_start{SteadyClock::now()};
+            if (partial_flush) {
+                if (!CoinsTip().Sync()) {
+                    return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+                }
+                coins_evicted = CoinsTip().EvictOldestCoins(m_coinstip_cache_size_bytes / 100 * retain_percent);
+            } else if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
                 return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
             }
+            // How long block processing was stalled by the flush, which with
+            // -dbasyncflush excludes the database write.
+            const auto coins_flush_stall{SteadyClock::now() - coins_flush_start};
+            if (partial_flush) {
+                LogPrintf("Kept %u coins (%.2f MiB) in the coins cache, evicted %u\n",
+                          CoinsTip().GetCacheSize(), CoinsTip().DynamicMemoryUsage() * (1.0 / (1 << 20)), coins_evicted);
+            }
+            ++m_coins_flush_stats.flushes;
+            if (partial_flush) ++m_coins_flush_stats.partial_flushes;
+            m_coins_flush_stats.coins_written += coins_dirty;
+            m_coins_flush_stats.coins_evicted += coins_evicted;
+            m_coins_flush_stats.last_stall = std::chrono::duration_cast<std::chrono::microseconds>(coins_flush_stall);
             m_last_flush = nNow;
             full_flush_completed = true;
             TRACEPOINT(utxocache, flush,
@@ -2960,7 +3177,16 @@ bool Chainstate::FlushStateToDisk(
     }
     if (full_flush_completed && m_chainman.m_options.signals) {
         // Update best block in wallet (so we can detect restored wallets).
-        m_chainman.m_options.signals->ChainStateFlushed(this->GetRole(), m_chain.GetLocator());
+        // With -dbasyncflush, wait until the coins are on disk, so that the
+        // wallet never records a best block the coins database is behind of.
+        m_unsignalled_flush = m_chain.GetLocator();
+    }
+    if (m_unsignalled_flush && mode == FlushStateMode::ALWAYS && !CoinsDB().SyncPendingWrite()) {
+        return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+    }
+    if (m_unsignalled_flush && !CoinsDB().HasPendingWrite()) {
+        m_chainman.m_options.signals->ChainStateFlushed(this->GetRole(), *m_unsignalled_flush);
+        m_unsignalled_flush.reset();
     }
     } catch (const std::runtime_error& e) {
         return FatalError(m_chainman.GetNotifications(), state, strprintf(_("System error while flushing: %s"), e.what()));
@@ -3162,22 +3388,165 @@ public:
     }
 };
 
+/**
+ * Return the outpoints spent by the non-coinbase transactions of a block,
+ * except for those created within the block itself, which can never be found
+ * in a view representing the state before the block.
+ */
+static std::vector<COutPoint> GetBlockPrevouts(const CBlock& block)
+{
+    std::unordered_set<Txid, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) block_txids.insert(tx->GetHash());
+
+    std::vector<COutPoint> prevouts;
+    for (const auto& tx : block.vtx | std::views::drop(1)) {
+        for (const CTxIn& txin : tx->vin) {
+            if (!block_txids.contains(txin.prevout.hash)) prevouts.push_back(txin.prevout);
+        }
+    }
+    return prevouts;
+}
+
+/**
+ * Read a block from disk and look up the coins spent by its transactions in
+ * the coins database. This runs on a background thread, so it must not touch
+ * anything that requires cs_main.
+ */
+static PrefetchedBlock ReadBlockAndCoins(const BlockManager& blockman, const FlatFilePos& pos, const uint256& block_hash, const CCoinsViewDB& db)
+{
+    PrefetchedBlock result;
+    auto block{std::make_shared<CBlock>()};
+    if (!blockman.ReadBlockFromDisk(*block, pos) || block->GetHash() != block_hash) {
+        return result;
+    }
+
+    // A flush always starts by erasing the best block marker and ends by
+    // writing the new one, so reading the same non-null marker before and
+    // after the lookups means all of them observed the same database state.
+    try {
+        const uint256 best_block{db.GetBestBlock()};
+        if (!best_block.IsNull()) {
+            for (const COutPoint& prevout : GetBlockPrevouts(*block)) {
+                if (auto coin{db.GetCoin(prevout)}) result.coins.emplace_back(prevout, std::move(*coin));
+            }
+            if (db.GetBestBlock() == best_block) result.coins_best_block = best_block;
+        }
+    } catch (const std::runtime_error&) {
+        // Leave read errors to be reported by the connecting thread.
+    }
+    if (result.coins_best_block.IsNull()) result.coins.clear();
+
+    result.block = std::move(block);
+    return result;
+}
+
+BlockPrefetchThread::~BlockPrefetchThread()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cv.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+std::future<PrefetchedBlock> BlockPrefetchThread::Start(std::function<PrefetchedBlock()> job)
+{
+    std::packaged_task<PrefetchedBlock()> task{std::move(job)};
+    auto result{task.get_future()};
+    {
+        LOCK(m_mutex);
+        Assume(!m_job.valid());
+        m_job = std::move(task);
+        if (!m_thread.joinable()) {
+            m_thread = std::thread{[this] {
+                util::ThreadRename("blockprefetch");
+                ThreadMain();
+            }};
+        }
+    }
+    m_cv.notify_one();
+    return result;
+}
+
+void BlockPrefetchThread::ThreadMain()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (true) {
+        m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_job.valid(); });
+        if (m_stop) return;
+        auto job{std::move(m_job)};
+        m_job = {};
+        REVERSE_LOCK(lock);
+        job();
+    }
+}
+
+void Chainstate::PrefetchBlock(const CBlockIndex& pindex)
+{
+    AssertLockHeld(cs_main);
+    CancelBlockPrefetch();
+    if (!(pindex.nStatus & BLOCK_HAVE_DATA)) return;
+
+    m_prefetch_index = &pindex;
+    m_prefetch_result = m_prefetch_thread.Start([&blockman = m_blockman, pos = pindex.GetBlockPos(), hash = pindex.GetBlockHash(), &db = CoinsDB()] {
+        return ReadBlockAndCoins(blockman, pos, hash, db);
+    });
+}
+
+std::optional<PrefetchedBlock> Chainstate::TakePrefetchedBlock(const CBlockIndex& pindex)
+{
+    AssertLockHeld(cs_main);
+    if (m_prefetch_index != &pindex) {
+        CancelBlockPrefetch();
+        return std::nullopt;
+    }
+    m_prefetch_index = nullptr;
+    return m_prefetch_result.get();
+}
+
+void Chainstate::CancelBlockPrefetch()
+{
+    AssertLockHeld(cs_main);
+    m_prefetch_index = nullptr;
+    if (m_prefetch_result.valid()) m_prefetch_result.wait();
+    m_prefetch_result = {};
+}
+
 /**
  * Connect a new block to m_chain. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
+ * If pindex_next is set and block prefetching is enabled, the block following
+ * pindexNew is read in the background while pindexNew is connected.
  *
  * The block is added to connectTrace if connection succeeds.
  */
-bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
+bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool, const CBlockIndex* pindex_next)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
 
     assert(pindexNew->pprev == m_chain.Tip());
-    // Read block from disk.
     const auto time_1{SteadyClock::now()};
+    std::optional<PrefetchedBlock> prefetched{TakePrefetchedBlock(*pindexNew)};
+    if (prefetched && !prefetched->coins.empty()) {
+        // The prefetched coins are only what fetching them now would return
+        // if the coins database has not been written to since.
+        if (prefetched->coins_best_block == CoinsDB().GetBestBlock()) {
+            for (auto& [outpoint, coin] : prefetched->coins) {
+                CoinsTip().EmplaceFetchedCoin(outpoint, std::move(coin));
+            }
+        }
+        prefetched->coins.clear();
+    }
+    if (pindex_next && m_chainman.m_options.block_prefetch) {
+        PrefetchBlock(*pindex_next);
+    }
+
+    // Read block from disk.
     std::shared_ptr<const CBlock> pthisBlock;
-    if (!pblock) {
+    if (!pblock && prefetched && prefetched->block) {
+        LogDebug(BCLog::BENCH, "  - Using prefetched block\n");
+        pthisBlock = std::move(prefetched->block);
+    } else if (!pblock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!m_blockman.ReadBlockFromDisk(*pblockNew, *pindexNew)) {
             return FatalError(m_chainman.GetNotifications(), state, _("Failed to read block."));
@@ -3195,6 +3564,11 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     // num_blocks_total may be zero until the ConnectBlock() call below.
     LogDebug(BCLog::BENCH, "  - Load block from disk: %.2fms\n",
              Ticks<MillisecondsDouble>(time_2 - time_1));
+    if (m_chainman.GetCoinsFetchQueue().HasThreads()) {
+        // Look up all inputs missing from the cache in parallel rather than
+        // one by one as ConnectBlock() accesses them.
+        CoinsTip().PrefetchCoins(GetBlockPrevouts(blockConnecting), m_chainman.GetCoinsFetchQueue());
+    }
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
@@ -3392,7 +3766,8 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
 
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : vpindexToConnect | std::views::reverse) {
-            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            const CBlockIndex* pindex_next{pindexConnect == pindexMostWork ? nullptr : pindexMostWork->GetAncestor(pindexConnect->nHeight + 1)};
+            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool, pindex_next)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
@@ -4149,8 +4524,16 @@ std::vector<unsigned char> ChainstateManager::GenerateCoinbaseCommitment(CBlock&
 
 bool HasValidProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
 {
-    return std::all_of(headers.cbegin(), headers.cend(),
-            [&](const auto& header) { return CheckProofOfWork(header.GetHash(), header.nBits, consensusParams);});
+    return HasValidProofOfWork(headers, GetBlockHeaderHashes(headers), consensusParams);
+}
+
+bool HasValidProofOfWork(std::span<const CBlockHeader> headers, std::span<const uint256> hashes, const Consensus::Params& consensusParams)
+{
+    assert(headers.size() == hashes.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (!CheckProofOfWork(hashes[i], headers[i].nBits, consensusParams)) return false;
+    }
+    return true;
 }
 
 bool IsBlockMutated(const CBlock& block, bool check_witness_root)
@@ -4809,9 +5192,8 @@ VerifyDBResult CVerifyDB::VerifyDB(
         }
         // check level 2: verify undo validity
         if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
             if (!pindex->GetUndoPos().IsNull()) {
-                if (!chainstate.m_blockman.UndoReadFromDisk(undo, *pindex)) {
+                if (!chainstate.m_blockman.OpenUndoCursor(*pindex)) {
                     LogPrintf("Verification error: found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
                     return VerifyDBResult::CORRUPTED_BLOCK_DB;
                 }
@@ -5018,10 +5400,8 @@ bool ChainstateManager::LoadBlockIndex()
 
         m_blockman.ScanAndUnlinkAlreadyPrunedFiles();
 
-        std::vector<CBlockIndex*> vSortedByHeight{m_blockman.GetAllBlockIndices()};
-        std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
-                  CBlockIndexHeightOnlyComparator());
-
+        const auto candidates_start{SteadyClock::now()};
+        std::vector<CBlockIndex*> vSortedByHeight{m_blockman.GetAllBlockIndicesByHeight()};
         for (CBlockIndex* pindex : vSortedByHeight) {
             if (m_interrupt) return false;
             // If we have an assumeutxo-based chainstate, then the snapshot
@@ -5043,6 +5423,8 @@ bool ChainstateManager::LoadBlockIndex()
             if (pindex->IsValid(BLOCK_VALID_TREE) && (m_best_header == nullptr || CBlockIndexWorkComparator()(m_best_header, pindex)))
                 m_best_header = pindex;
         }
+        LogPrintf("%s: set up block index candidates in %.2fms\n", __func__,
+                  Ticks<MillisecondsDouble>(SteadyClock::now() - candidates_start));
     }
     return true;
 }
@@ -5077,6 +5459,117 @@ bool Chainstate::LoadGenesisBlock()
     return true;
 }
 
+bool ChainstateManager::LoadExternalBlock(
+    const CBlockHeader& header,
+    const uint256& hash,
+    const FlatFilePos* dbp,
+    const std::function<std::shared_ptr<CBlock>()>& read_block,
+    std::multimap<uint256, FlatFilePos>* blocks_with_unknown_parent,
+    int& nLoaded)
+{
+    const CChainParams& params{GetParams()};
+
+    std::shared_ptr<CBlock> pblock{}; // needs to remain available after the cs_main lock is released to avoid duplicate reads from disk
+
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(header.hashPrevBlock)) {
+            LogDebug(BCLog::REINDEX, "LoadExternalBlockFile: Out of order block %s, parent %s not known\n", hash.ToString(),
+                     header.hashPrevBlock.ToString());
+            if (dbp && blocks_with_unknown_parent) {
+                blocks_with_unknown_parent->emplace(header.hashPrevBlock, *dbp);
+            }
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+            pblock = read_block();
+
+            BlockValidationState state;
+            if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr, true)) {
+                nLoaded++;
+            }
+            if (state.IsError()) {
+                return false;
+            }
+        } else if (hash != params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+            LogDebug(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == params.GetConsensus().hashGenesisBlock) {
+        bool genesis_activation_failure = false;
+        for (auto c : GetAll()) {
+            BlockValidationState state;
+            if (!c->ActivateBestChain(state, nullptr)) {
+                genesis_activation_failure = true;
+                break;
+            }
+        }
+        if (genesis_activation_failure) {
+            return false;
+        }
+    }
+
+    if (m_blockman.IsPruneMode() && m_blockman.m_blockfiles_indexed && pblock) {
+        // must update the tip for pruning to work while importing with -loadblock.
+        // this is a tradeoff to conserve disk space at the expense of time
+        // spent updating the tip to be able to prune.
+        // otherwise, ActivateBestChain won't be called by the import process
+        // until after all of the block files are loaded. ActivateBestChain can be
+        // called by concurrent network message processing. but, that is not
+        // reliable for the purpose of pruning while importing.
+        bool activation_failure = false;
+        for (auto c : GetAll()) {
+            BlockValidationState state;
+            if (!c->ActivateBestChain(state, pblock)) {
+                LogDebug(BCLog::REINDEX, "failed to activate chain (%s)\n", state.ToString());
+                activation_failure = true;
+                break;
+            }
+        }
+        if (activation_failure) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip();
+
+    if (!blocks_with_unknown_parent) return true;
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        auto range = blocks_with_unknown_parent->equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+            if (m_blockman.ReadBlockFromDisk(*pblockrecursive, it->second)) {
+                LogDebug(BCLog::REINDEX, "LoadExternalBlockFile: Processing out of order child %s of %s\n", pblockrecursive->GetHash().ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                BlockValidationState dummy;
+                if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr, true)) {
+                    nLoaded++;
+                    queue.push_back(pblockrecursive->GetHash());
+                }
+            }
+            range.first++;
+            blocks_with_unknown_parent->erase(it);
+            NotifyHeaderTip();
+        }
+    }
+
+    return true;
+}
+
 void ChainstateManager::LoadExternalBlockFile(
     AutoFile& file_in,
     FlatFilePos* dbp,
@@ -5133,106 +5626,16 @@ void ChainstateManager::LoadExternalBlockFile(
                 nRewind = nBlockPos + nSize;
                 blkdat.SkipTo(nRewind);
 
-                std::shared_ptr<CBlock> pblock{}; // needs to remain available after the cs_main lock is released to avoid duplicate reads from disk
-
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(header.hashPrevBlock)) {
-                        LogDebug(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                 header.hashPrevBlock.ToString());
-                        if (dbp && blocks_with_unknown_parent) {
-                            blocks_with_unknown_parent->emplace(header.hashPrevBlock, *dbp);
-                        }
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                        // This block can be processed immediately; rewind to its start, read and deserialize it.
-                        blkdat.SetPos(nBlockPos);
-                        pblock = std::make_shared<CBlock>();
-                        blkdat >> TX_WITH_WITNESS(*pblock);
-                        nRewind = blkdat.GetPos();
-
-                        BlockValidationState state;
-                        if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr, true)) {
-                            nLoaded++;
-                        }
-                        if (state.IsError()) {
-                            break;
-                        }
-                    } else if (hash != params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                        LogDebug(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
-                }
-
-                // Activate the genesis block so normal node progress can continue
-                if (hash == params.GetConsensus().hashGenesisBlock) {
-                    bool genesis_activation_failure = false;
-                    for (auto c : GetAll()) {
-                        BlockValidationState state;
-                        if (!c->ActivateBestChain(state, nullptr)) {
-                            genesis_activation_failure = true;
-                            break;
-                        }
-                    }
-                    if (genesis_activation_failure) {
-                        break;
-                    }
-                }
-
-                if (m_blockman.IsPruneMode() && m_blockman.m_blockfiles_indexed && pblock) {
-                    // must update the tip for pruning to work while importing with -loadblock.
-                    // this is a tradeoff to conserve disk space at the expense of time
-                    // spent updating the tip to be able to prune.
-                    // otherwise, ActivateBestChain won't be called by the import process
-                    // until after all of the block files are loaded. ActivateBestChain can be
-                    // called by concurrent network message processing. but, that is not
-                    // reliable for the purpose of pruning while importing.
-                    bool activation_failure = false;
-                    for (auto c : GetAll()) {
-                        BlockValidationState state;
-                        if (!c->ActivateBestChain(state, pblock)) {
-                            LogDebug(BCLog::REINDEX, "failed to activate chain (%s)\n", state.ToString());
-                            activation_failure = true;
-                            break;
-                        }
-                    }
-                    if (activation_failure) {
-                        break;
-                    }
-                }
-
-                NotifyHeaderTip();
-
-                if (!blocks_with_unknown_parent) continue;
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    auto range = blocks_with_unknown_parent->equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (m_blockman.ReadBlockFromDisk(*pblockrecursive, it->second)) {
-                            LogDebug(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            BlockValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr, true)) {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        blocks_with_unknown_parent->erase(it);
-                        NotifyHeaderTip();
-                    }
+                const auto read_block{[&] {
+                    // This block can be processed immediately; rewind to its start, read and deserialize it.
+                    blkdat.SetPos(nBlockPos);
+                    auto pblock{std::make_shared<CBlock>()};
+                    blkdat >> TX_WITH_WITNESS(*pblock);
+                    nRewind = blkdat.GetPos();
+                    return pblock;
+                }};
+                if (!LoadExternalBlock(header, hash, dbp, read_block, blocks_with_unknown_parent, nLoaded)) {
+                    break;
                 }
             } catch (const std::exception& e) {
                 // historical bugs added extra data to the block files that does not deserialize cleanly.
@@ -5255,6 +5658,86 @@ void ChainstateManager::LoadExternalBlockFile(
     LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
 }
 
+void ChainstateManager::LoadExternalBlocks(std::vector<ExternalBlock>&& blocks, std::multimap<uint256, FlatFilePos>& blocks_with_unknown_parent)
+{
+    const auto start{SteadyClock::now()};
+
+    int nLoaded = 0;
+    for (ExternalBlock& external : blocks) {
+        if (m_interrupt) return;
+
+        // Let go of each block once it has been accepted, to free its memory
+        // as early as possible.
+        const std::shared_ptr<CBlock> pblock{std::move(external.block)};
+        try {
+            if (!LoadExternalBlock(*pblock, external.hash, &external.pos, [&] { return pblock; }, &blocks_with_unknown_parent, nLoaded)) {
+                break;
+            }
+        } catch (const std::exception& e) {
+            LogDebug(BCLog::REINDEX, "%s: failed to load block %s at %s - %s. continuing\n", __func__, external.hash.ToString(), external.pos.ToString(), e.what());
+        }
+    }
+    LogPrintf("Loaded %i blocks from block file in %dms\n", nLoaded, Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
+}
+
+std::vector<ExternalBlock> ReadExternalBlockFile(AutoFile& file_in, int file_num, const CChainParams& params, const util::SignalInterrupt& interrupt)
+{
+    std::vector<ExternalBlock> blocks;
+
+    // This follows the scan in ChainstateManager::LoadExternalBlockFile(),
+    // except that every block is deserialized.
+    BufferedFile blkdat{file_in, 2 * MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE + 8};
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof()) {
+        if (interrupt) break;
+
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            MessageStartChars buf;
+            blkdat.FindByte(std::byte(params.MessageStart()[0]));
+            nRewind = blkdat.GetPos() + 1;
+            blkdat >> buf;
+            if (buf != params.MessageStart()) {
+                continue;
+            }
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; this happens at the end of every blk.dat file
+            break;
+        }
+        try {
+            // read block header, so that the scan skips the block if the rest
+            // of it fails to deserialize, as LoadExternalBlockFile() does
+            const uint64_t nBlockPos{blkdat.GetPos()};
+            blkdat.SetLimit(nBlockPos + nSize);
+            CBlockHeader header;
+            blkdat >> header;
+            nRewind = nBlockPos + nSize;
+
+            blkdat.SetPos(nBlockPos);
+            auto pblock{std::make_shared<CBlock>()};
+            blkdat >> TX_WITH_WITNESS(*pblock);
+            nRewind = blkdat.GetPos();
+
+            // The result is cached in the block, and checked again when it is accepted.
+            BlockValidationState state;
+            CheckBlock(*pblock, state, params.GetConsensus());
+            blocks.push_back({FlatFilePos{file_num, static_cast<unsigned int>(nBlockPos)}, header.GetHash(), std::move(pblock)});
+        } catch (const std::exception& e) {
+            // See the comment about unexpected data in LoadExternalBlockFile().
+            LogDebug(BCLog::REINDEX, "%s: unexpected data at offset 0x%x of blk%05u.dat - %s. continuing\n", __func__, (nRewind - 1), file_num, e.what());
+        }
+    }
+    return blocks;
+}
+
 bool ChainstateManager::ShouldCheckBlockIndex() const
 {
     // Assert to verify Flatten() has been called.
@@ -5594,6 +6077,7 @@ bool Chainstate::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
     size_t old_coinstip_size = m_coinstip_cache_size_bytes;
     m_coinstip_cache_size_bytes = coinstip_size;
     m_coinsdb_cache_size_bytes = coinsdb_size;
+    CancelBlockPrefetch();
     CoinsDB().ResizeCache(coinsdb_size);
 
     LogPrintf("[%s] resized coinsdb cache to %.1f MiB\n",
@@ -5934,6 +6418,43 @@ util::Result<void> ChainstateManager::PopulateAndValidateSnapshot(
     LogPrintf("[snapshot] loading %d coins from snapshot %s\n", coins_left, base_blockhash.ToString());
     int64_t coins_processed{0};
 
+    // As above, okay to immediately release cs_main here since no other context knows
+    // about the snapshot_chainstate.
+    CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
+
+    // Coins are decoded on this thread, a chunk at a time. While the next chunk
+    // is decoded, the previous one is hashed and written to the database on two
+    // other threads. Snapshots written by dumptxoutset list the coins in the
+    // order of the database, so they are written as sorted batches, straight to
+    // the database rather than through the coins cache, and hashing them in
+    // file order gives the content hash without reading them back.
+    using SnapshotChunk = std::vector<std::pair<COutPoint, Coin>>;
+    HashWriter content_hasher{};
+    std::future<void> hashing;
+    std::future<bool> writing;
+    const auto wait_for_chunk{[&]() -> bool {
+        if (hashing.valid()) hashing.get();
+        return !writing.valid() || writing.get();
+    }};
+    const auto submit_chunk{[&](SnapshotChunk&& coins) -> bool {
+        if (!wait_for_chunk()) return false;
+        auto chunk{std::make_shared<const SnapshotChunk>(std::move(coins))};
+        hashing = std::async(std::launch::async, [&content_hasher, chunk] {
+            for (const auto& [outpoint, coin] : *chunk) {
+                kernel::ApplyCoinHash(content_hasher, outpoint, coin);
+            }
+        });
+        writing = std::async(std::launch::async, [snapshot_coinsdb, chunk] {
+            return snapshot_coinsdb->WriteSnapshotCoins(*chunk);
+        });
+        return true;
+    }};
+
+    // If our average Coin size is roughly 41 bytes, a chunk takes about 5MB.
+    constexpr size_t SNAPSHOT_CHUNK_COINS{120000};
+    SnapshotChunk chunk;
+    chunk.reserve(SNAPSHOT_CHUNK_COINS);
+
     while (coins_left > 0) {
         try {
             Txid txid;
@@ -5961,39 +6482,25 @@ util::Result<void> ChainstateManager::PopulateAndValidateSnapshot(
                     return util::Error{Untranslated(strprintf("Bad snapshot data after deserializing %d coins - bad tx out value",
                               coins_count - coins_left))};
                 }
-                coins_cache.EmplaceCoinInternalDANGER(std::move(outpoint), std::move(coin));
+                chunk.emplace_back(std::move(outpoint), std::move(coin));
 
                 --coins_left;
                 ++coins_processed;
 
                 if (coins_processed % 1000000 == 0) {
-                    LogPrintf("[snapshot] %d coins loaded (%.2f%%, %.2f MB)\n",
+                    LogPrintf("[snapshot] %d coins loaded (%.2f%%)\n",
                         coins_processed,
-                        static_cast<float>(coins_processed) * 100 / static_cast<float>(coins_count),
-                        coins_cache.DynamicMemoryUsage() / (1000 * 1000));
+                        static_cast<float>(coins_processed) * 100 / static_cast<float>(coins_count));
                 }
 
-                // Batch write and flush (if we need to) every so often.
-                //
-                // If our average Coin size is roughly 41 bytes, checking every 120,000 coins
-                // means <5MB of memory imprecision.
-                if (coins_processed % 120000 == 0) {
+                if (chunk.size() == SNAPSHOT_CHUNK_COINS) {
                     if (m_interrupt) {
                         return util::Error{Untranslated("Aborting after an interrupt was requested")};
                     }
-
-                    const auto snapshot_cache_state = WITH_LOCK(::cs_main,
-                        return snapshot_chainstate.GetCoinsCacheSizeState());
-
-                    if (snapshot_cache_state >= CoinsCacheSizeState::CRITICAL) {
-                        // This is a hack - we don't know what the actual best block is, but that
-                        // doesn't matter for the purposes of flushing the cache here. We'll set this
-                        // to its correct value (`base_blockhash`) below after the coins are loaded.
-                        coins_cache.SetBestBlock(GetRandHash());
-
-                        // No need to acquire cs_main since this chainstate isn't being used yet.
-                        FlushSnapshotToDisk(coins_cache, /*snapshot_loaded=*/false);
+                    if (!submit_chunk(std::exchange(chunk, {}))) {
+                        return util::Error{Untranslated("Failed to write snapshot coins to the database")};
                     }
+                    chunk.reserve(SNAPSHOT_CHUNK_COINS);
                 }
             }
         } catch (const std::ios_base::failure&) {
@@ -6001,12 +6508,14 @@ util::Result<void> ChainstateManager::PopulateAndValidateSnapshot(
                       coins_processed))};
         }
     }
+    if (!submit_chunk(std::move(chunk)) || !wait_for_chunk()) {
+        return util::Error{Untranslated("Failed to write snapshot coins to the database")};
+    }
 
-    // Important that we set this. This and the coins_cache accesses above are
-    // sort of a layer violation, but either we reach into the innards of
-    // CCoinsViewCache here or we have to invert some of the Chainstate to
-    // embed them in a snapshot-activation-specific CCoinsViewCache bulk load
-    // method.
+    // Important that we set this. This and the coins database accesses above
+    // are sort of a layer violation, but either we reach into the innards of
+    // the coins views here or we have to invert some of the Chainstate to
+    // embed them in a snapshot-activation-specific bulk load method.
     coins_cache.SetBestBlock(base_blockhash);
 
     bool out_of_coins{false};
@@ -6022,36 +6531,39 @@ util::Result<void> ChainstateManager::PopulateAndValidateSnapshot(
             coins_count))};
     }
 
-    LogPrintf("[snapshot] loaded %d (%.2f MB) coins from snapshot %s\n",
+    LogPrintf("[snapshot] loaded %d coins from snapshot %s\n",
         coins_count,
-        coins_cache.DynamicMemoryUsage() / (1000 * 1000),
         base_blockhash.ToString());
 
     // No need to acquire cs_main since this chainstate isn't being used yet.
+    // The cache is empty, so this only records the best block.
     FlushSnapshotToDisk(coins_cache, /*snapshot_loaded=*/true);
 
     assert(coins_cache.GetBestBlock() == base_blockhash);
 
-    // As above, okay to immediately release cs_main here since no other context knows
-    // about the snapshot_chainstate.
-    CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
-
-    std::optional<CCoinsStats> maybe_stats;
-
-    try {
-        maybe_stats = ComputeUTXOStats(
-            CoinStatsHashType::HASH_SERIALIZED, snapshot_coinsdb, m_blockman, [&interrupt = m_interrupt] { SnapshotUTXOHashBreakpoint(interrupt); });
-    } catch (StopHashingException const&) {
-        return util::Error{Untranslated("Aborting after an interrupt was requested")};
-    }
-    if (!maybe_stats.has_value()) {
-        return util::Error{Untranslated("Failed to generate coins stats")};
+    // The hash of the coins in the order they were read only matches if they
+    // were in database order, which implies that the database holds exactly
+    // the same coins. Otherwise, hash the database contents to find out.
+    uint256 content_hash{content_hasher.GetHash()};
+    if (AssumeutxoHash{content_hash} != au_data.hash_serialized) {
+        LogPrintf("[snapshot] coins are not in database order, hashing the loaded coins\n");
+        std::optional<CCoinsStats> maybe_stats;
+        try {
+            maybe_stats = ComputeUTXOStats(
+                CoinStatsHashType::HASH_SERIALIZED, snapshot_coinsdb, m_blockman, [&interrupt = m_interrupt] { SnapshotUTXOHashBreakpoint(interrupt); });
+        } catch (StopHashingException const&) {
+            return util::Error{Untranslated("Aborting after an interrupt was requested")};
+        }
+        if (!maybe_stats.has_value()) {
+            return util::Error{Untranslated("Failed to generate coins stats")};
+        }
+        content_hash = maybe_stats->hashSerialized;
     }
 
     // Assert that the deserialized chainstate contents match the expected assumeutxo value.
-    if (AssumeutxoHash{maybe_stats->hashSerialized} != au_data.hash_serialized) {
+    if (AssumeutxoHash{content_hash} != au_data.hash_serialized) {
         return util::Error{Untranslated(strprintf("Bad snapshot content hash: expected %s, got %s",
-            au_data.hash_serialized.ToString(), maybe_stats->hashSerialized.ToString()))};
+            au_data.hash_serialized.ToString(), content_hash.ToString()))};
     }
 
     snapshot_chainstate.m_chain.SetTip(*snapshot_start_block);
@@ -6089,8 +6601,8 @@ util::Result<void> ChainstateManager::PopulateAndValidateSnapshot(
     index->m_chain_tx_count = au_data.m_chain_tx_count;
     snapshot_chainstate.setBlockIndexCandidates.insert(snapshot_start_block);
 
-    LogPrintf("[snapshot] validated snapshot (%.2f MB)\n",
-        coins_cache.DynamicMemoryUsage() / (1000 * 1000));
+    LogPrintf("[snapshot] validated snapshot (%.2f MB on disk)\n",
+        snapshot_coinsdb->EstimateSize() / (1000.0 * 1000));
     return {};
 }
 
@@ -6310,11 +6822,25 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
 
 ChainstateManager::ChainstateManager(const util::SignalInterrupt& interrupt, Options options, node::BlockManager::Options blockman_options)
     : m_script_check_queue{/*batch_size=*/128, std::clamp(options.worker_threads_num, 0, MAX_SCRIPTCHECK_THREADS)},
+      m_coins_fetch_queue{/*batch_size=*/16, std::clamp(options.coins_prefetch_threads, 0, MAX_COINS_PREFETCH_THREADS), /*thread_name=*/"coinsfetch"},
+      // The precheck reads the inputs through PeekCoin(), which does not
+      // fill the cache, so without prefetching every input would be read
+      // from the database twice.
+      m_tx_precheck_queue{/*batch_size=*/8, options.coins_prefetch_threads > 0 ? std::clamp(options.tx_precheck_threads, 0, MAX_TX_PRECHECK_THREADS) : 0, /*thread_name=*/"txprecheck"},
       m_interrupt{interrupt},
       m_options{Flatten(std::move(options))},
       m_blockman{interrupt, std::move(blockman_options)},
       m_validation_cache{m_options.script_execution_cache_bytes, m_options.signature_cache_bytes}
 {
+    LogInfo("Script verification uses %d additional threads", std::clamp(m_options.worker_threads_num, 0, MAX_SCRIPTCHECK_THREADS));
+    if (m_coins_fetch_queue.HasThreads()) {
+        LogInfo("Block input prefetching uses %d threads", std::clamp(m_options.coins_prefetch_threads, 0, MAX_COINS_PREFETCH_THREADS));
+    }
+    if (m_tx_precheck_queue.HasThreads()) {
+        LogInfo("Block input checking uses %d additional threads", std::clamp(m_options.tx_precheck_threads, 0, MAX_TX_PRECHECK_THREADS));
+    } else if (m_options.tx_precheck_threads > 0) {
+        LogWarning("-parconnect has no effect without -coinsprefetchthreads");
+    }
 }
 
 ChainstateManager::~ChainstateManager()
@@ -6386,7 +6912,7 @@ util::Result<void> Chainstate::InvalidateCoinsDBOnDisk()
     fs::path snapshot_datadir = GetSnapshotCoinsDBPath(*this);
 
     // Coins views no longer usable.
-    m_coins_views.reset();
+    ResetCoinsViews();
 
     auto invalid_path = snapshot_datadir + "_INVALID";
     std::string dbpath = fs::PathToString(snapshot_datadir);
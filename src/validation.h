@@ -35,6 +35,9 @@
 #include <versionbits.h>
 
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <optional>
@@ -42,6 +45,7 @@
 #include <span>
 #include <stdint.h>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -80,6 +84,10 @@ static const uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
 
 /** Maximum number of dedicated script-checking threads allowed */
 static constexpr int MAX_SCRIPTCHECK_THREADS{15};
+/** Maximum number of threads allowed for fetching block inputs from the coins database */
+static constexpr int MAX_COINS_PREFETCH_THREADS{64};
+/** Maximum number of dedicated threads allowed for checking block inputs ahead of connecting the block */
+static constexpr int MAX_TX_PRECHECK_THREADS{15};
 
 /** Current sync state passed to tip changed callbacks. */
 enum class SynchronizationState {
@@ -347,7 +355,18 @@ public:
     CScriptCheck(CScriptCheck&&) = default;
     CScriptCheck& operator=(CScriptCheck&&) = default;
 
-    std::optional<std::pair<ScriptError, std::string>> operator()();
+    std::optional<std::pair<ScriptError, std::string>> operator()() { return Check(/*deferred=*/nullptr); }
+
+    /**
+     * Run a batch of checks, verifying the Schnorr signatures of all of them
+     * together at the end if SchnorrBatch::IS_BATCHED. If anything fails, the
+     * checks are run again one by one, so the result is always the same as
+     * running them in order.
+     */
+    static std::optional<std::pair<ScriptError, std::string>> BatchCheck(std::span<CScriptCheck> checks);
+
+private:
+    std::optional<std::pair<ScriptError, std::string>> Check(DeferredSchnorrChecks* deferred);
 };
 
 // CScriptCheck is used a lot in std::vector, make sure that's efficient
@@ -355,6 +374,43 @@ static_assert(std::is_nothrow_move_assignable_v<CScriptCheck>);
 static_assert(std::is_nothrow_move_constructible_v<CScriptCheck>);
 static_assert(std::is_nothrow_destructible_v<CScriptCheck>);
 
+/**
+ * Closure running the input checks ConnectBlock() does for a transaction
+ * before spending its inputs: looking them up, CheckTxInputs(), BIP68 and
+ * counting sigops. It is run on a CCheckQueue ahead of connecting the block,
+ * for transactions that do not spend outputs created in the same block.
+ */
+class TxInputsPrecheck
+{
+public:
+    struct Result {
+        //! Whether all checks passed. Otherwise the transaction must be
+        //! checked again as usual, and the other fields are not set.
+        bool ok{false};
+        CAmount fee{0};
+        int64_t sigops_cost{0};
+    };
+
+private:
+    const CTransaction* m_tx;
+    const CCoinsView* m_view;
+    const CBlockIndex* m_block;
+    int m_lock_time_flags;
+    unsigned int m_script_flags;
+    PrecomputedTransactionData* m_txdata;
+    Result* m_result;
+
+public:
+    //! If txdata is set, it is initialized with the spent outputs once all
+    //! checks passed. The view must support concurrent PeekCoin() calls.
+    TxInputsPrecheck(const CTransaction& tx LIFETIMEBOUND, const CCoinsView& view LIFETIMEBOUND, const CBlockIndex& block LIFETIMEBOUND,
+                     int lock_time_flags, unsigned int script_flags, PrecomputedTransactionData* txdata, Result& result LIFETIMEBOUND)
+        : m_tx(&tx), m_view(&view), m_block(&block), m_lock_time_flags(lock_time_flags), m_script_flags(script_flags), m_txdata(txdata), m_result(&result) {}
+
+    //! Returns the reason if a check failed.
+    std::optional<std::string> operator()();
+};
+
 /**
  * Convenience class for initializing and passing the script execution cache
  * and signature cache.
@@ -383,6 +439,26 @@ public:
 /** Context-independent validity checks */
 bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
 
+/** A block read from a block file, with its hash and where it starts in the file. */
+struct ExternalBlock {
+    FlatFilePos pos;
+    uint256 hash;
+    std::shared_ptr<CBlock> block;
+};
+
+/**
+ * Locate and deserialize all blocks in a block file, the way
+ * ChainstateManager::LoadExternalBlockFile() does, and run the
+ * context-independent checks on them, so that accepting them later does not
+ * have to. Blocks that fail the checks are returned all the same. Used by the
+ * worker threads of a parallel -reindex.
+ *
+ * @param[in] file_in   Block file to read
+ * @param[in] file_num  Number of the block file, for the positions of its blocks
+ * @throws std::runtime_error on a system error reading the file
+ */
+std::vector<ExternalBlock> ReadExternalBlockFile(AutoFile& file_in, int file_num, const CChainParams& params, const util::SignalInterrupt& interrupt);
+
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(BlockValidationState& state,
                        const CChainParams& chainparams,
@@ -394,6 +470,8 @@ bool TestBlockValidity(BlockValidationState& state,
 
 /** Check with the proof of work on each blockheader matches the value in nBits */
 bool HasValidProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams);
+/** Same, for headers whose hashes (see GetBlockHeaderHashes()) have been computed already */
+bool HasValidProofOfWork(std::span<const CBlockHeader> headers, std::span<const uint256> hashes, const Consensus::Params& consensusParams);
 
 /** Check if a block has been mutated (with respect to its merkle root and witness commitments). */
 bool IsBlockMutated(const CBlock& block, bool check_witness_root);
@@ -478,6 +556,44 @@ public:
     void InitCache() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 };
 
+/**
+ * A block that was read from disk while its parent was being connected,
+ * together with the coins spent by its inputs that were found in the coins
+ * database at that time.
+ *
+ * @sa Chainstate::PrefetchBlock()
+ */
+struct PrefetchedBlock {
+    //! The block, or nullptr if it could not be read.
+    std::shared_ptr<const CBlock> block;
+    //! Best block of the coins database the coins were read at. Null if the
+    //! database was modified while the coins were being read.
+    uint256 coins_best_block;
+    std::vector<std::pair<COutPoint, Coin>> coins;
+};
+
+/**
+ * Runs block prefetches one at a time on a single background thread, which is
+ * started on first use and joined on destruction.
+ */
+class BlockPrefetchThread
+{
+public:
+    ~BlockPrefetchThread();
+
+    //! Run job on the thread. The previously started job must have completed.
+    std::future<PrefetchedBlock> Start(std::function<PrefetchedBlock()> job) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    void ThreadMain() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::packaged_task<PrefetchedBlock()> m_job GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+
 enum class CoinsCacheSizeState
 {
     //! The coins cache is in immediate need of a flush.
@@ -487,6 +603,20 @@ enum class CoinsCacheSizeState
     OK = 0
 };
 
+//! Counters describing how the coins cache of a chainstate has been written to disk.
+struct CoinsFlushStats {
+    //! Number of times the coins cache was written to the coins database.
+    uint64_t flushes{0};
+    //! How many of those kept part of the cache (see -dbcacheretain).
+    uint64_t partial_flushes{0};
+    //! Number of modified coins written.
+    uint64_t coins_written{0};
+    //! Number of unmodified coins dropped from the cache after a partial flush.
+    uint64_t coins_evicted{0};
+    //! How long block processing was stalled by the most recent flush.
+    std::chrono::microseconds last_stall{0};
+};
+
 /**
  * Chainstate stores and provides an API to update our local knowledge of the
  * current best chain.
@@ -637,7 +767,11 @@ public:
     }
 
     //! Destructs all objects related to accessing the UTXO set.
-    void ResetCoinsViews() { m_coins_views.reset(); }
+    void ResetCoinsViews() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
+    {
+        CancelBlockPrefetch();
+        m_coins_views.reset();
+    }
 
     //! Does this chainstate have a UTXO set attached?
     bool HasCoinsViews() const { return (bool)m_coins_views; }
@@ -648,6 +782,12 @@ public:
     //! The cache size of the in-memory coins view.
     size_t m_coinstip_cache_size_bytes{0};
 
+    //! Statistics about writing the in-memory coins view to disk.
+    CoinsFlushStats m_coins_flush_stats GUARDED_BY(::cs_main){};
+    //! Locator of a flush whose ChainStateFlushed signal waits for the
+    //! background coins write to complete.
+    std::optional<CBlockLocator> m_unsignalled_flush GUARDED_BY(::cs_main);
+
     //! Resize the CoinsViews caches dynamically and flush state to disk.
     //! @returns true unless an error occurred during the flush.
     bool ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
@@ -771,7 +911,23 @@ public:
 
 private:
     bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
-    bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool, const CBlockIndex* pindex_next = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+
+    /**
+     * Start reading the block of pindex, and the coins it spends that are in
+     * the coins database, on a background thread. Any previously started
+     * prefetch is discarded.
+     */
+    void PrefetchBlock(const CBlockIndex& pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Wait for the pending prefetch and return its result if it was started
+     * for pindex. A prefetch for any other block is discarded.
+     */
+    std::optional<PrefetchedBlock> TakePrefetchedBlock(const CBlockIndex& pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    //! Wait for and discard the pending prefetch, if any.
+    void CancelBlockPrefetch() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void InvalidBlockFound(CBlockIndex* pindex, const BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -811,6 +967,14 @@ private:
      */
     [[nodiscard]] util::Result<void> InvalidateCoinsDBOnDisk() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    //! Block being prefetched, if any. The pending result must be waited for
+    //! before the coins database it reads from is resized or destructed.
+    const CBlockIndex* m_prefetch_index GUARDED_BY(::cs_main){nullptr};
+    std::future<PrefetchedBlock> m_prefetch_result GUARDED_BY(::cs_main);
+    //! Declared after m_coins_views, so that a running prefetch is waited for
+    //! before the coins database is destructed.
+    BlockPrefetchThread m_prefetch_thread;
+
     friend ChainstateManager;
 };
 
@@ -906,6 +1070,19 @@ private:
 
     bool NotifyHeaderTip() LOCKS_EXCLUDED(GetMutex());
 
+    /**
+     * Accept a block found in a block file by LoadExternalBlockFile() or
+     * LoadExternalBlocks(), and any blocks in blocks_with_unknown_parent
+     * waiting for it. read_block is only called if the block is to be
+     * accepted. Returns false if loading the file should stop.
+     */
+    bool LoadExternalBlock(const CBlockHeader& header,
+                           const uint256& hash,
+                           const FlatFilePos* dbp,
+                           const std::function<std::shared_ptr<CBlock>()>& read_block,
+                           std::multimap<uint256, FlatFilePos>* blocks_with_unknown_parent,
+                           int& nLoaded);
+
     //! Internal helper for ActivateSnapshot().
     //!
     //! De-serialization of a snapshot that is created with
@@ -949,6 +1126,12 @@ private:
     //! A queue for script verifications that have to be performed by worker threads.
     CCheckQueue<CScriptCheck> m_script_check_queue;
 
+    //! A queue for looking up block inputs in the coins database on worker threads.
+    CoinsFetchQueue m_coins_fetch_queue;
+
+    //! A queue for checking the inputs of independent block transactions on worker threads.
+    CCheckQueue<TxInputsPrecheck> m_tx_precheck_queue;
+
     //! Timers and counters used for benchmarking validation in both background
     //! and active chainstates.
     SteadyClock::duration GUARDED_BY(::cs_main) time_check{};
@@ -1182,6 +1365,14 @@ public:
         FlatFilePos* dbp = nullptr,
         std::multimap<uint256, FlatFilePos>* blocks_with_unknown_parent = nullptr);
 
+    /**
+     * Accept the blocks of a block file that ReadExternalBlockFile() has
+     * already located and deserialized, in the order they appear in the file,
+     * tracking blocks with unknown parent as LoadExternalBlockFile() does
+     * during -reindex.
+     */
+    void LoadExternalBlocks(std::vector<ExternalBlock>&& blocks, std::multimap<uint256, FlatFilePos>& blocks_with_unknown_parent);
+
     /**
      * Process an incoming block. This only returns after the best known valid
      * block is made active. Note that it does not, however, guarantee that the
@@ -1323,6 +1514,8 @@ public:
     void RecalculateBestHeader() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     CCheckQueue<CScriptCheck>& GetCheckQueue() { return m_script_check_queue; }
+    CoinsFetchQueue& GetCoinsFetchQueue() { return m_coins_fetch_queue; }
+    CCheckQueue<TxInputsPrecheck>& GetTxPrecheckQueue() { return m_tx_precheck_queue; }
 
     ~ChainstateManager();
 };
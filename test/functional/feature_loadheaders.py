@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the dumpheaders RPC and the -loadheaders option.
+
+- Mine blocks on node0 and write its headers to a file with dumpheaders.
+- Start the unconnected node1 with -loadheaders and check that it knows the
+  headers, but not the blocks.
+- Check that the headers are also loaded with -reindex.
+- Check that a file that can not be loaded shuts the node down.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class LoadHeadersTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        self.setup_nodes()
+        # The nodes are never connected
+
+    def assert_headers_only(self, node, tip_hash, height):
+        assert_equal(node.getblockcount(), 0)
+        assert_equal(node.getblockheader(tip_hash)["height"], height)
+        assert {"height": height, "hash": tip_hash, "branchlen": height, "status": "headers-only"} in node.getchaintips()
+
+    def run_test(self):
+        node0, node1 = self.nodes
+        self.generate(node0, 20, sync_fun=self.no_op)
+        tip_hash = node0.getbestblockhash()
+
+        self.log.info("Write the headers of node0 to a file")
+        headers_path = node0.datadir_path / "headers.dat"
+        result = node0.dumpheaders(str(headers_path))
+        assert_equal(result["headers_written"], 20)
+        assert_equal(result["tip_hash"], tip_hash)
+        assert_equal(result["path"], str(headers_path))
+
+        self.log.info("Load the headers into node1")
+        with node1.assert_debug_log(["Loaded 20 headers"]):
+            self.restart_node(1, extra_args=[f"-loadheaders={headers_path}"])
+            self.wait_until(lambda: tip_hash in [tip["hash"] for tip in node1.getchaintips()])
+        self.assert_headers_only(node1, tip_hash, 20)
+
+        self.log.info("Load the headers into node1 while reindexing")
+        with node1.assert_debug_log(["Loaded 20 headers"]):
+            self.restart_node(1, extra_args=["-reindex", f"-loadheaders={headers_path}"])
+            self.wait_until(lambda: tip_hash in [tip["hash"] for tip in node1.getchaintips()])
+        self.assert_headers_only(node1, tip_hash, 20)
+
+        self.log.info("A headers file that can not be loaded shuts the node down")
+        bad_path = node1.datadir_path / "bad_headers.dat"
+        bad_path.write_bytes(headers_path.read_bytes()[:-40])
+        self.stop_node(1)
+        with node1.assert_debug_log(["Failed to read headers file"]):
+            node1.start(extra_args=[f"-loadheaders={bad_path}"])
+            node1.wait_until_stopped(expect_error=True, expected_stderr=f"Error: A fatal internal error occurred, see debug.log for details: Failed to load headers from {bad_path}.")
+
+
+if __name__ == '__main__':
+    LoadHeadersTest(__file__).main()